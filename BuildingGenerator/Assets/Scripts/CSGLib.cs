@@ -1,9 +1,42 @@
 ﻿using UnityEngine;
 using System;
+using System.Collections.Generic;
 using System.Runtime.InteropServices;
 
 public class CSGLib
 {
+	// Matches ShapeOperations in CompositeShape.h.
+	public const int SHAPE_OP_SHAPE = 0;
+	public const int SHAPE_OP_UNION = 1;
+	public const int SHAPE_OP_DIFFERENCE = 2;
+	public const int SHAPE_OP_INTERSECTION = 3;
+
+	// Matches CSGShapes in CompositeShape.h.
+	public const int SHAPE_TYPE_CUBOID = 0;
+	public const int SHAPE_TYPE_MODULE = 1;
+	public const int SHAPE_TYPE_COMPOSITE = 2;
+	public const int SHAPE_TYPE_PRISM = 3;
+
+	// Matches BuildingModuleType in BuildingModules.h.
+	public const int MODULE_TYPE_WINDOW_CUTOUT = 0;
+	public const int MODULE_TYPE_DOOR_FRAME = 1;
+	public const int MODULE_TYPE_FLOOR_SLAB = 2;
+
+	// Matches CSGPrimitiveDesc in CompositeShapeDesc.h.
+	[StructLayout(LayoutKind.Sequential)]
+	public struct CSGPrimitiveDesc
+	{
+		public double positionX, positionY, positionZ;
+		public double dimensionsX, dimensionsY, dimensionsZ;
+		public double orientationA, orientationB, orientationC, orientationD;
+		public double moduleParameterA, moduleParameterB, moduleParameterC, moduleParameterD, moduleParameterE, moduleParameterF; // See CreateBuildingModule().
+		public int shapeType;
+		public int compositeID; // The composite to place, for SHAPE_TYPE_COMPOSITE.
+		public int firstPoint; // The range of points holding the outline, for SHAPE_TYPE_PRISM.
+		public int numPoints;
+		public int moduleType; // One of the MODULE_TYPE constants, for SHAPE_TYPE_MODULE.
+	}
+
 	[DllImport("BuildingGeneratorCPP")]
 	public static extern void RegisterDebugOutput(IntPtr pHandler);
 
@@ -13,4 +46,110 @@ public class CSGLib
 	[DllImport("BuildingGeneratorCPP")]
 	public static extern int TestContains(double x, double y, double z);
 
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern void SetCompositeProfiling(int numSamplePoints);
+
+	// Returns the composite's ID, or -1 if the description is malformed. Every other function taking an ID rejects -1.
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int CreateComposite(CSGPrimitiveDesc[] primitives, int numPrimitives, int[] operations, int numOperations, double[] points, int numPoints);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int CreateCompositeFromLevel(double wallHeight, double wallThickness, double floorThickness, int[] wallPoints, int[] wallPointCounts, int numWalls, int[] floorPoints, int[] floorPointCounts, int numFloors);
+
+	[UnmanagedFunctionPointer(CallingConvention.StdCall)]
+	public unsafe delegate void MeshChunkHandler(float* vertices, float* normals, int numVertices, int* triangles, int numIndices);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern void GenerateCompositeMesh(int compositeID, double originX, double originY, double originZ, double sizeX, double sizeY, double sizeZ, double voxelSize, MeshChunkHandler handler);
+
+	// Returns IntPtr.Zero if the composite doesn't exist or the settings are invalid.
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern IntPtr BeginCompositeMeshStream(int compositeID, double originX, double originY, double originZ, double sizeX, double sizeY, double sizeZ, double voxelSize, int numChunks);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern unsafe int AcquireMeshChunk(IntPtr stream, out float* vertices, out float* normals, out int numVertices, out int* triangles, out int numIndices);
+
+	// Returns 1, or -1 if the stream has no acquired chunk to release.
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int ReleaseMeshChunk(IntPtr stream);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern void EndCompositeMeshStream(IntPtr stream);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int GenerateCompositeLODs(int compositeID, double baseVoxelSize, int numLevels);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int GetCompositeLODNumChunks(int compositeID, double baseVoxelSize, int numLevels, int level);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern unsafe void GetCompositeLODChunk(int compositeID, double baseVoxelSize, int numLevels, int level, int chunk, out float* vertices, out float* normals, out int numVertices, out int* triangles, out int numIndices);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern void GetCompositeMemoryUsage(int compositeID, out long primitives, out long nodes, out long caches, out long meshes);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int CompositesOverlap(int compositeA, int compositeB);
+
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int FindOverlappingComposites(int[] pairs, int maxPairs);
+
+	// Tests the composite as if it were moved to the position and orientation, without creating anything. Fills ids with the
+	// other composites it would overlap and returns how many there are, which may be more than ids holds, or -1 if the composite doesn't exist.
+	[DllImport("BuildingGeneratorCPP")]
+	public static extern int FindPlacementOverlaps(int compositeID, double x, double y, double z, double orientationA, double orientationB, double orientationC, double orientationD, int[] ids, int maxIDs);
+
+	// Builds the whole level natively in one call. Returns the composite's ID, or -1 if it could not be built.
+	public static int CreateCompositeFromLevel(BuildingBlueprint.Level level)
+	{
+		List<int> wallPoints = new List<int>();
+		int[] wallPointCounts = new int[level._walls.Count];
+		for (int i = 0; i < level._walls.Count; ++i)
+		{
+			wallPointCounts[i] = FlattenPoints(level._walls[i]._points, wallPoints);
+		}
+
+		List<int> floorPoints = new List<int>();
+		int[] floorPointCounts = new int[level._floors.Count];
+		for (int i = 0; i < level._floors.Count; ++i)
+		{
+			floorPointCounts[i] = FlattenPoints(level._floors[i]._points, floorPoints);
+		}
+
+		return CreateCompositeFromLevel(level._wallHeight, level._wallThickness, level._floorThickness,
+			wallPoints.ToArray(), wallPointCounts, wallPointCounts.Length,
+			floorPoints.ToArray(), floorPointCounts, floorPointCounts.Length);
+	}
+
+	private static int FlattenPoints(List<Tuples.IntTuple2> points, List<int> outPoints)
+	{
+		foreach (Tuples.IntTuple2 point in points)
+		{
+			outPoints.Add(point.e0);
+			outPoints.Add(point.e1);
+		}
+		return points.Count;
+	}
+
+	// Copy a native mesh chunk straight into a Unity mesh, without building up intermediate lists.
+	public static unsafe Mesh CreateChunkMesh(float* vertices, float* normals, int numVertices, int* triangles, int numIndices)
+	{
+		Vector3[] meshVerts = new Vector3[numVertices];
+		Vector3[] meshNormals = new Vector3[numVertices];
+		for (int i = 0; i < numVertices; ++i)
+		{
+			meshVerts[i] = new Vector3(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+			meshNormals[i] = new Vector3(normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+		}
+
+		int[] meshTris = new int[numIndices];
+		Marshal.Copy(new IntPtr(triangles), meshTris, 0, numIndices);
+
+		Mesh mesh = new Mesh();
+		mesh.vertices = meshVerts;
+		mesh.normals = meshNormals;
+		mesh.triangles = meshTris;
+		mesh.RecalculateBounds();
+		return mesh;
+	}
 }
@@ -1,15 +1,23 @@
 ﻿using UnityEngine;
+using System;
 using System.Collections.Generic;
-using System.Runtime.InteropServices;
 
 public class CSGVoxellizer : MonoBehaviour
 {
-	[DllImport("BuildingGeneratorCPP")]
-	public static extern int TestContains(double x, double y, double z);
+	private const int NUM_MESH_CHUNKS = 3;
 
 	private bool init = false;
+	private IntPtr _meshStream = IntPtr.Zero;
+	private Material _material;
+
 	void Update()
 	{
+		if (_meshStream != IntPtr.Zero)
+		{
+			UploadMeshChunks();
+			return;
+		}
+
 		if (init || !Input.GetKeyDown(KeyCode.F1))
 		{
 			return;
@@ -18,25 +26,64 @@ void Update()
 
 		float voxelSize = 0.25f;
 		float csgSize = 5.0f;
-		int numIterations = (int)(csgSize / voxelSize);
 
-		for (int i = 0; i < numIterations; ++i)
+		CSGLib.CSGPrimitiveDesc[] primitives = new CSGLib.CSGPrimitiveDesc[1];
+		primitives[0].dimensionsX = 1.0;
+		primitives[0].dimensionsY = 1.0;
+		primitives[0].dimensionsZ = 1.0;
+		primitives[0].orientationA = 1.0;
+		primitives[0].shapeType = CSGLib.SHAPE_TYPE_CUBOID;
+		int[] operations = { CSGLib.SHAPE_OP_SHAPE };
+		int compositeID = CSGLib.CreateComposite(primitives, primitives.Length, operations, operations.Length, null, 0);
+		if (compositeID == -1)
+		{
+			Debug.LogError("CSGVoxellizer: the composite could not be built.");
+			return;
+		}
+
+		// The native mesher runs on its own thread; chunks are uploaded as they become ready over the next frames.
+		_material = new Material(Shader.Find("Standard"));
+		_meshStream = CSGLib.BeginCompositeMeshStream(compositeID, 0.0, 0.0, 0.0, csgSize, csgSize, csgSize, voxelSize, NUM_MESH_CHUNKS);
+		if (_meshStream == IntPtr.Zero)
+		{
+			Debug.LogError("CSGVoxellizer: the mesh stream could not be started.");
+		}
+	}
+
+	void OnDestroy()
+	{
+		if (_meshStream != IntPtr.Zero)
+		{
+			CSGLib.EndCompositeMeshStream(_meshStream);
+			_meshStream = IntPtr.Zero;
+		}
+	}
+
+	private unsafe void UploadMeshChunks()
+	{
+		float* vertices;
+		float* normals;
+		int numVertices;
+		int* triangles;
+		int numIndices;
+
+		int status;
+		while ((status = CSGLib.AcquireMeshChunk(_meshStream, out vertices, out normals, out numVertices, out triangles, out numIndices)) == 1)
+		{
+			Mesh chunkMesh = CSGLib.CreateChunkMesh(vertices, normals, numVertices, triangles, numIndices);
+			CSGLib.ReleaseMeshChunk(_meshStream);
+
+			GameObject chunkObject = new GameObject("CSG Mesh Chunk");
+			chunkObject.transform.parent = transform;
+			chunkObject.transform.localPosition = new Vector3(-2.5f, -2.5f, -2.5f);
+			chunkObject.AddComponent<MeshFilter>().sharedMesh = chunkMesh;
+			chunkObject.AddComponent<MeshRenderer>().sharedMaterial = _material;
+		}
+
+		if (status == -1)
 		{
-			float x = i * voxelSize;
-			for (int j = 0; j < numIterations; ++j)
-			{
-				float y = j * voxelSize;
-				for (int k = 0; k < numIterations; ++k)
-				{
-					float z = k * voxelSize;
-					if (TestContains(x, y, z) == 1)
-					{
-						GameObject voxel = GameObject.CreatePrimitive(PrimitiveType.Cube);
-						voxel.transform.position = new Vector3(x - 2.5f, y - 2.5f, z - 2.5f);
-						voxel.transform.localScale = new Vector3(voxelSize, voxelSize, voxelSize);
-					}
-				}
-			}
+			CSGLib.EndCompositeMeshStream(_meshStream);
+			_meshStream = IntPtr.Zero;
 		}
 	}
 }
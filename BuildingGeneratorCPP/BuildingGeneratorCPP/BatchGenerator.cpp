@@ -0,0 +1,233 @@
+// A command line tool that bakes every BuildingBlueprint in a directory without Unity, spreading the blueprints across cores.
+// Like Test.cpp it isn't part of the plugin project. On Linux, build it from this directory with:
+//
+//     g++ -std=c++11 -O2 -pthread -o BatchGenerator BatchGenerator.cpp $(ls *.cpp ShapePrimitives/*.cpp | grep -v -e BatchGenerator.cpp -e Test.cpp)
+//
+// Usage: BatchGenerator <blueprint directory> <output directory> [--voxel-size <size>] [--lods <count>] [--threads <count>]
+//
+// The voxel size also spaces the samples for whatever part of each level's volume can't be calculated exactly.
+//
+// The output directory is created if need be, and each blueprint is written to <output directory>/<blueprint name>.bgmesh, in
+// the format BlueprintBaker.h describes. Assets that aren't BuildingBlueprints are skipped.
+
+#include "BlueprintBaker.h"
+#include "MemoryResource.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    const size_t s_ScratchBlockSize = 1024 * 1024;
+
+    struct BatchSettings
+    {
+        BatchSettings()
+            : voxelSize(0.25)
+            , numLODs(1)
+            , numThreads(std::max(std::thread::hardware_concurrency(), 1u))
+        {
+        }
+
+        double voxelSize;
+        size_t numLODs;
+        unsigned int numThreads;
+    };
+
+    // ------------------------------------------------------------------------
+
+    bool ListBlueprintAssets(const std::string& directory, std::vector<std::string>& outNames)
+    {
+#ifdef _WIN32
+        WIN32_FIND_DATAA findData;
+        HANDLE find = FindFirstFileA((directory + "\\*.asset").c_str(), &findData);
+        if (find == INVALID_HANDLE_VALUE)
+        {
+            return GetLastError() == ERROR_FILE_NOT_FOUND;
+        }
+        do
+        {
+            outNames.push_back(findData.cFileName);
+        }
+        while (FindNextFileA(find, &findData));
+        FindClose(find);
+#else
+        DIR* dir = opendir(directory.c_str());
+        if (dir == nullptr)
+        {
+            return false;
+        }
+        while (dirent* entry = readdir(dir))
+        {
+            std::string name = entry->d_name;
+            if (name.size() > 6 && name.compare(name.size() - 6, 6, ".asset") == 0)
+            {
+                outNames.push_back(name);
+            }
+        }
+        closedir(dir);
+#endif
+
+        std::sort(outNames.begin(), outNames.end());
+        return true;
+    }
+
+    // Creates the directory along with any missing parents. Succeeds if it already exists.
+    bool CreateDirectories(const std::string& directory)
+    {
+        for (size_t end = directory.find_first_of("/\\", 1); ; end = directory.find_first_of("/\\", end + 1))
+        {
+            std::string parent = directory.substr(0, end);
+#ifdef _WIN32
+            bool created = parent.empty() || parent[parent.size() - 1] == ':' || CreateDirectoryA(parent.c_str(), nullptr)
+                || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+            bool created = mkdir(parent.c_str(), 0777) == 0 || errno == EEXIST;
+#endif
+            if (!created)
+            {
+                return false;
+            }
+            if (end == std::string::npos)
+            {
+                return true;
+            }
+        }
+    }
+
+    void PrintUsage()
+    {
+        std::printf("Usage: BatchGenerator <blueprint directory> <output directory> [--voxel-size <size>] [--lods <count>] [--threads <count>]\n");
+    }
+}
+
+// ------------------------------------------------------------------------
+
+int main(int numArgs, char* args[])
+{
+    if (numArgs < 3)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const std::string inputDirectory = args[1];
+    const std::string outputDirectory = args[2];
+
+    BatchSettings settings;
+    for (int i = 3; i < numArgs; ++i)
+    {
+        bool hasValue = (i + 1) < numArgs;
+        if (hasValue && std::strcmp(args[i], "--voxel-size") == 0)
+        {
+            settings.voxelSize = std::atof(args[++i]);
+        }
+        else if (hasValue && std::strcmp(args[i], "--lods") == 0)
+        {
+            settings.numLODs = static_cast<size_t>(std::max(std::atoi(args[++i]), 1));
+        }
+        else if (hasValue && std::strcmp(args[i], "--threads") == 0)
+        {
+            settings.numThreads = static_cast<unsigned int>(std::max(std::atoi(args[++i]), 1));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (settings.voxelSize <= 0.0)
+    {
+        std::printf("The voxel size must be positive.\n");
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    if (!ListBlueprintAssets(inputDirectory, names))
+    {
+        std::printf("Can't read %s\n", inputDirectory.c_str());
+        return 1;
+    }
+    if (!CreateDirectories(outputDirectory))
+    {
+        std::printf("Can't create %s\n", outputDirectory.c_str());
+        return 1;
+    }
+
+    // Blueprints are independent, so each worker just takes the next one until none are left.
+    std::atomic<size_t> nextBlueprint(0);
+    std::atomic<size_t> numSkipped(0);
+    std::atomic<size_t> numFailed(0);
+    std::mutex outputMutex;
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Fetched before any workers start, since Visual Studio 2013 doesn't make function statics thread safe.
+    MemoryResource* upstream = GetDefaultMemoryResource();
+
+    auto work = [&]()
+    {
+        MonotonicMemoryResource scratch(s_ScratchBlockSize, upstream);
+
+        for (size_t index = nextBlueprint++; index < names.size(); index = nextBlueprint++)
+        {
+            const std::string& name = names[index];
+            std::string inputPath = inputDirectory + "/" + name;
+            std::string outputPath = outputDirectory + "/" + name.substr(0, name.size() - 6) + ".bgmesh";
+
+            std::string summary;
+            BlueprintBakeResult result = BakeBlueprint(inputPath, outputPath, settings.voxelSize, settings.numLODs, scratch, summary);
+            scratch.Release();
+
+            const char* outcome = "Baked";
+            if (result == BlueprintBakeResult::Skipped)
+            {
+                ++numSkipped;
+                outcome = "Skipped";
+            }
+            else if (result == BlueprintBakeResult::Failed)
+            {
+                ++numFailed;
+                outcome = "Failed";
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            std::printf("%s %s: %s\n", outcome, name.c_str(), summary.c_str());
+        }
+    };
+
+    unsigned int numThreads = std::min(settings.numThreads, static_cast<unsigned int>(std::max(names.size(), static_cast<size_t>(1))));
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < numThreads; ++i)
+    {
+        workers.push_back(std::thread(work));
+    }
+    work(); // The main thread pulls its weight too.
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    size_t numBlueprints = names.size() - numSkipped;
+    std::printf("%d of %d blueprints baked in %.2fs on %u threads, skipping %d other assets.\n",
+        static_cast<int>(numBlueprints - numFailed), static_cast<int>(numBlueprints), seconds, numThreads, static_cast<int>(numSkipped));
+
+    return (numFailed == 0) ? 0 : 1;
+}
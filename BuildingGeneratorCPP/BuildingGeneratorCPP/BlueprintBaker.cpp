@@ -0,0 +1,276 @@
+
+#include "BlueprintBaker.h"
+#include "BuildingLevelBuilder.h"
+#include "CompositeLODChain.h"
+#include "CompositeShape.h"
+#include "MemoryResource.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    // The guid Unity gave BuildingBlueprint.cs, which every blueprint's m_Script refers to.
+    const char* const s_BlueprintScriptGuid = "e7b41f1f9e0f9e34db046eceebd9e73a";
+
+    template <typename T>
+    void WriteValue(std::ofstream& file, const T& value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T, typename TAllocator>
+    void WriteArray(std::ofstream& file, const std::vector<T, TAllocator>& values)
+    {
+        if (!values.empty())
+        {
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+    }
+}
+
+// ------------------------------------------------------------------------
+
+// Only the handful of block style constructs Unity writes for BuildingBlueprint are understood, so this is no general YAML parser.
+bool ReadBlueprintAsset(const std::string& path, std::vector<BlueprintLevel>& outLevels, bool& outIsBlueprint, std::string& outError)
+{
+    outIsBlueprint = false;
+
+    std::ifstream file(path.c_str());
+    if (!file)
+    {
+        outError = "can't be opened";
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line.compare(0, 5, "%YAML") != 0)
+    {
+        outError = "isn't a text asset. Set Unity's Asset Serialization mode to Force Text and save it again";
+        return false;
+    }
+
+    bool inFloors = false; // Otherwise in walls, once inside a level.
+    bool awaitingE1 = false;
+
+    for (size_t lineNumber = 2; std::getline(file, line); ++lineNumber)
+    {
+        if (!line.empty() && line[line.size() - 1] == '\r')
+        {
+            line.erase(line.size() - 1);
+        }
+
+        size_t start = line.find_first_not_of(' ');
+        if (start == std::string::npos)
+        {
+            continue;
+        }
+
+        // A leading "- " starts a new element of whichever list the key belongs to.
+        bool isNewElement = line.compare(start, 2, "- ") == 0;
+        if (isNewElement)
+        {
+            start = line.find_first_not_of(' ', start + 2);
+        }
+
+        size_t colon = line.find(':', start);
+        if (colon == std::string::npos)
+        {
+            continue;
+        }
+        std::string key = line.substr(start, colon - start);
+        const char* value = line.c_str() + colon + 1;
+
+        // Unity writes the script ahead of the fields, so other classes are turned away before their fields are mistaken for ours.
+        if (key == "m_Script")
+        {
+            outIsBlueprint = std::strstr(value, s_BlueprintScriptGuid) != nullptr;
+            if (!outIsBlueprint)
+            {
+                return true;
+            }
+            continue;
+        }
+        if (!outIsBlueprint)
+        {
+            continue;
+        }
+
+        bool isLevelKey = (key == "_wallHeight" || key == "_wallThickness" || key == "_floorThickness" || key == "_walls" || key == "_floors");
+        if (isLevelKey && isNewElement)
+        {
+            outLevels.push_back(BlueprintLevel());
+        }
+        if (!isLevelKey && key != "_points" && key != "e0" && key != "e1")
+        {
+            continue;
+        }
+        if (outLevels.empty())
+        {
+            outError = "has level data outside of a level on line " + std::to_string(lineNumber);
+            return false;
+        }
+
+        BlueprintLevel& level = outLevels.back();
+        std::vector<int>& points = inFloors ? level.floorPoints : level.wallPoints;
+        std::vector<int>& pointCounts = inFloors ? level.floorPointCounts : level.wallPointCounts;
+
+        if (key == "_wallHeight")
+        {
+            level.wallHeight = std::atof(value);
+        }
+        else if (key == "_wallThickness")
+        {
+            level.wallThickness = std::atof(value);
+        }
+        else if (key == "_floorThickness")
+        {
+            level.floorThickness = std::atof(value);
+        }
+        else if (key == "_walls" || key == "_floors")
+        {
+            inFloors = (key == "_floors");
+        }
+        else if (key == "_points")
+        {
+            if (isNewElement)
+            {
+                pointCounts.push_back(0);
+            }
+        }
+        else if (key == "e0")
+        {
+            if (!isNewElement || pointCounts.empty() || awaitingE1)
+            {
+                outError = "has a malformed point on line " + std::to_string(lineNumber);
+                return false;
+            }
+            points.push_back(std::atoi(value));
+            ++pointCounts.back();
+            awaitingE1 = true;
+        }
+        else if (key == "e1")
+        {
+            if (!awaitingE1)
+            {
+                outError = "has a malformed point on line " + std::to_string(lineNumber);
+                return false;
+            }
+            points.push_back(std::atoi(value));
+            awaitingE1 = false;
+        }
+    }
+
+    if (awaitingE1)
+    {
+        outError = "ends in the middle of a point";
+        return false;
+    }
+    return true;
+}
+
+BlueprintBakeResult BakeBlueprint(const std::string& inputPath, const std::string& outputPath, double voxelSize, size_t numLODs,
+    MonotonicMemoryResource& scratch, std::string& outSummary)
+{
+    std::vector<BlueprintLevel> levels;
+    bool isBlueprint = false;
+    std::string error;
+    if (!ReadBlueprintAsset(inputPath, levels, isBlueprint, error))
+    {
+        outSummary = error;
+        return BlueprintBakeResult::Failed;
+    }
+    if (!isBlueprint)
+    {
+        outSummary = "isn't a BuildingBlueprint";
+        return BlueprintBakeResult::Skipped;
+    }
+
+    std::ofstream file(outputPath.c_str(), std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        outSummary = "can't write " + outputPath;
+        return BlueprintBakeResult::Failed;
+    }
+
+    file.write("BGMH", 4);
+    WriteValue(file, BLUEPRINT_MESH_FILE_VERSION);
+    WriteValue(file, static_cast<uint32_t>(levels.size()));
+
+    size_t numVertices = 0;
+    double totalVolume = 0.0;
+
+    std::vector<CSGPrimitiveDesc> primitives;
+    std::vector<int> operations;
+    std::vector<double> points;
+
+    for (const BlueprintLevel& level : levels)
+    {
+        BuildingLevelDesc levelDesc;
+        levelDesc.wallHeight = level.wallHeight;
+        levelDesc.wallThickness = level.wallThickness;
+        levelDesc.floorThickness = level.floorThickness;
+        levelDesc.wallPoints = level.wallPoints.data();
+        levelDesc.wallPointCounts = level.wallPointCounts.data();
+        levelDesc.numWalls = static_cast<int>(level.wallPointCounts.size());
+        levelDesc.floorPoints = level.floorPoints.data();
+        levelDesc.floorPointCounts = level.floorPointCounts.data();
+        levelDesc.numFloors = static_cast<int>(level.floorPointCounts.size());
+
+        primitives.clear();
+        operations.clear();
+        points.clear();
+        DescribeBuildingLevel(levelDesc, primitives, operations, points);
+
+        CompositeShapeDesc desc;
+        desc.primitives = primitives.data();
+        desc.numPrimitives = primitives.size();
+        desc.operations = operations.data();
+        desc.numOperations = operations.size();
+        desc.points = points.data();
+        desc.numPoints = points.size() / 2;
+
+        CompositeShape composite(&scratch);
+        if (!composite.Build(desc, nullptr, 0))
+        {
+            outSummary = "has a level that can't be built";
+            return BlueprintBakeResult::Failed;
+        }
+
+        double volume = composite.CalcVolume(voxelSize);
+        totalVolume += volume;
+
+        CompositeLODChain chain;
+        chain.Generate(composite, voxelSize, numLODs);
+
+        WriteValue(file, volume);
+        WriteValue(file, static_cast<uint32_t>(chain.NumLevels()));
+        for (size_t i = 0; i < chain.NumLevels(); ++i)
+        {
+            const CompositeLODChain::LODLevel& lod = chain.GetLevel(i);
+            WriteValue(file, lod.voxelSize);
+            WriteValue(file, static_cast<uint32_t>(lod.chunks.size()));
+
+            for (const CompositeLODChain::LODMeshChunk& chunk : lod.chunks)
+            {
+                WriteValue(file, static_cast<uint32_t>(chunk.vertices.size() / 3));
+                WriteValue(file, static_cast<uint32_t>(chunk.triangles.size()));
+                WriteArray(file, chunk.vertices);
+                WriteArray(file, chunk.normals);
+                WriteArray(file, chunk.triangles);
+
+                numVertices += (i == 0) ? chunk.vertices.size() / 3 : 0;
+            }
+        }
+    }
+
+    if (!file)
+    {
+        outSummary = "failed while writing " + outputPath;
+        return BlueprintBakeResult::Failed;
+    }
+
+    outSummary = std::to_string(levels.size()) + " levels, volume " + std::to_string(totalVolume) + ", " + std::to_string(numVertices) + " vertices";
+    return BlueprintBakeResult::Baked;
+}
@@ -0,0 +1,63 @@
+// Bakes BuildingBlueprint assets into mesh files without Unity. Like BatchGenerator, which drives it, it isn't part of the
+// plugin project.
+//
+// Blueprints must be saved as text, i.e. with Unity's Asset Serialization mode set to Force Text, as this project is. Each
+// blueprint is written in the host's byte order:
+//
+//     char[4] "BGMH", uint32 version, uint32 numLevels
+//     per level: double volume, uint32 numLODs
+//         per LOD: double voxelSize, uint32 numChunks
+//             per chunk: uint32 numVertices, uint32 numIndices, float[numVertices * 3] vertices, float[numVertices * 3] normals,
+//                        int32[numIndices] triangles
+
+#pragma once
+
+#ifndef INCLUDED_BLUEPRINT_BAKER_H
+#define INCLUDED_BLUEPRINT_BAKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class MonotonicMemoryResource;
+
+const uint32_t BLUEPRINT_MESH_FILE_VERSION = 1;
+
+// One BuildingBlueprint.Level, with its points flattened the way BuildingLevelDesc expects.
+struct BlueprintLevel
+{
+    BlueprintLevel()
+        : wallHeight(0.0)
+        , wallThickness(0.0)
+        , floorThickness(0.0)
+    {
+    }
+
+    double wallHeight;
+    double wallThickness;
+    double floorThickness;
+    std::vector<int> wallPoints;
+    std::vector<int> wallPointCounts;
+    std::vector<int> floorPoints;
+    std::vector<int> floorPointCounts;
+};
+
+enum class BlueprintBakeResult
+{
+    Baked,
+    Skipped, // The asset isn't a BuildingBlueprint, as other assets sharing its directory needn't be.
+    Failed,
+};
+
+// Reads the _levels of a BuildingBlueprint saved as Unity YAML. Assets of any other class are recognised by their script and
+// read no further, leaving outIsBlueprint false. Fails with a description of the problem if the asset can't be read.
+bool ReadBlueprintAsset(const std::string& path, std::vector<BlueprintLevel>& outLevels, bool& outIsBlueprint, std::string& outError);
+
+// Builds, measures and meshes every level of one blueprint, and writes them to the output path. Nothing is written for assets
+// that are skipped. The summary describes what was baked, or why not. All of the composites' storage comes from the scratch
+// arena, which the caller resets once the blueprint is done.
+BlueprintBakeResult BakeBlueprint(const std::string& inputPath, const std::string& outputPath, double voxelSize, size_t numLODs,
+    MonotonicMemoryResource& scratch, std::string& outSummary);
+
+#endif // INCLUDED_BLUEPRINT_BAKER_H
@@ -0,0 +1,109 @@
+
+#include "BoundingBox.h"
+#include "Matrix4x4.h"
+
+#include <algorithm>
+#include <limits>
+
+BoundingBox::BoundingBox()
+    : minCorner(std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), 1.0)
+    , maxCorner(-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity(), 1.0)
+{
+}
+
+BoundingBox::BoundingBox(const Vector4& minCorner0, const Vector4& maxCorner0)
+    : minCorner(minCorner0)
+    , maxCorner(maxCorner0)
+{
+}
+
+BoundingBox::BoundingBox(const BoundingBox& other)
+    : minCorner(other.minCorner)
+    , maxCorner(other.maxCorner)
+{
+}
+
+bool BoundingBox::IsEmpty() const
+{
+    return (minCorner.x > maxCorner.x) || (minCorner.y > maxCorner.y) || (minCorner.z > maxCorner.z);
+}
+
+bool BoundingBox::Contains(const Vector4& point) const
+{
+    return (point.x >= minCorner.x && point.x <= maxCorner.x)
+        && (point.y >= minCorner.y && point.y <= maxCorner.y)
+        && (point.z >= minCorner.z && point.z <= maxCorner.z);
+}
+
+bool BoundingBox::Overlaps(const BoundingBox& other) const
+{
+    return (minCorner.x <= other.maxCorner.x && maxCorner.x >= other.minCorner.x)
+        && (minCorner.y <= other.maxCorner.y && maxCorner.y >= other.minCorner.y)
+        && (minCorner.z <= other.maxCorner.z && maxCorner.z >= other.minCorner.z);
+}
+
+Vector4 BoundingBox::CalcSize() const
+{
+    if (IsEmpty())
+    {
+        return Vector4();
+    }
+    return Vector4(maxCorner.x - minCorner.x, maxCorner.y - minCorner.y, maxCorner.z - minCorner.z, 0.0);
+}
+
+double BoundingBox::CalcMaxExtent() const
+{
+    Vector4 size = CalcSize();
+    return std::max(size.x, std::max(size.y, size.z));
+}
+
+BoundingBox BoundingBox::CalcIntersection(const BoundingBox& other) const
+{
+    return BoundingBox(
+        Vector4(std::max(minCorner.x, other.minCorner.x), std::max(minCorner.y, other.minCorner.y), std::max(minCorner.z, other.minCorner.z), 1.0),
+        Vector4(std::min(maxCorner.x, other.maxCorner.x), std::min(maxCorner.y, other.maxCorner.y), std::min(maxCorner.z, other.maxCorner.z), 1.0));
+}
+
+BoundingBox BoundingBox::CalcTransformed(const Matrix4x4& transform) const
+{
+    BoundingBox bounds;
+    if (IsEmpty())
+    {
+        return bounds;
+    }
+
+    const Vector4* corners[2] = { &minCorner, &maxCorner };
+    for (size_t i = 0; i < 8; ++i)
+    {
+        Vector4 corner(corners[i & 1]->x, corners[(i >> 1) & 1]->y, corners[(i >> 2) & 1]->z, 1.0);
+        bounds.Encapsulate(transform.TransformPoint(corner));
+    }
+    return bounds;
+}
+
+void BoundingBox::Encapsulate(const Vector4& point)
+{
+    minCorner.x = std::min(minCorner.x, point.x);
+    minCorner.y = std::min(minCorner.y, point.y);
+    minCorner.z = std::min(minCorner.z, point.z);
+
+    maxCorner.x = std::max(maxCorner.x, point.x);
+    maxCorner.y = std::max(maxCorner.y, point.y);
+    maxCorner.z = std::max(maxCorner.z, point.z);
+}
+
+void BoundingBox::Encapsulate(const BoundingBox& other)
+{
+    if (other.IsEmpty())
+    {
+        return;
+    }
+    Encapsulate(other.minCorner);
+    Encapsulate(other.maxCorner);
+}
+
+void BoundingBox::operator=(const BoundingBox& rhs)
+{
+    minCorner = rhs.minCorner;
+    maxCorner = rhs.maxCorner;
+}
@@ -0,0 +1,37 @@
+// An axis aligned bounding box. The corners are treated as 3D vectors.
+
+#pragma once
+
+#ifndef INCLUDED_BOUNDING_BOX_H
+#define INCLUDED_BOUNDING_BOX_H
+
+#include "Vector4.h"
+
+class Matrix4x4;
+
+class BoundingBox
+{
+public:
+    BoundingBox(); // An empty box, which contains nothing and overlaps nothing.
+    BoundingBox(const Vector4& minCorner0, const Vector4& maxCorner0);
+    BoundingBox(const BoundingBox& other);
+
+    bool IsEmpty() const;
+    bool Contains(const Vector4& point) const;
+    bool Overlaps(const BoundingBox& other) const;
+
+    Vector4 CalcSize() const;
+    double CalcMaxExtent() const; // The size along the box's largest axis.
+    BoundingBox CalcIntersection(const BoundingBox& other) const;
+    BoundingBox CalcTransformed(const Matrix4x4& transform) const; // Bounds all eight transformed corners. Empty boxes stay empty.
+
+    void Encapsulate(const Vector4& point);
+    void Encapsulate(const BoundingBox& other);
+
+    void operator=(const BoundingBox& rhs);
+
+    Vector4 minCorner;
+    Vector4 maxCorner;
+};
+
+#endif // INCLUDED_BOUNDING_BOX_H
@@ -0,0 +1,252 @@
+
+#include "BuildingLevelBuilder.h"
+#include "CompositeShape.h"
+#include "ShapePrimitives/BuildingModules.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Keeps mitres on very sharp corners from reaching far past the wall, as in SVG's default stroke-miterlimit.
+    const double s_MinMitreCosine = 0.25;
+
+    CSGPrimitiveDesc CreatePrimitive(CSGShapes shapeType)
+    {
+        CSGPrimitiveDesc primitive;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            primitive.position[i] = 0.0;
+            primitive.dimensions[i] = 0.0;
+        }
+        primitive.orientation[0] = 1.0;
+        primitive.orientation[1] = 0.0;
+        primitive.orientation[2] = 0.0;
+        primitive.orientation[3] = 0.0;
+        for (size_t i = 0; i < 6; ++i)
+        {
+            primitive.moduleParameters[i] = 0.0;
+        }
+        primitive.shapeType = static_cast<int>(shapeType);
+        primitive.compositeID = -1;
+        primitive.firstPoint = -1;
+        primitive.numPoints = 0;
+        primitive.moduleType = static_cast<int>(BuildingModuleType::Invalid);
+        return primitive;
+    }
+
+    void AddPrimitive(const CSGPrimitiveDesc& primitive, ShapeOperations operation, std::vector<CSGPrimitiveDesc>& outPrimitives, std::vector<int>& outOperations)
+    {
+        outPrimitives.push_back(primitive);
+
+        // Combine everything into one tree as it is added.
+        bool isFirst = outOperations.empty();
+        outOperations.push_back(static_cast<int>(ShapeOperations::Shape));
+        if (!isFirst)
+        {
+            outOperations.push_back(static_cast<int>(operation));
+        }
+    }
+
+    void AddPrism(size_t firstPoint, double height, std::vector<CSGPrimitiveDesc>& outPrimitives, std::vector<int>& outOperations, const std::vector<double>& points)
+    {
+        CSGPrimitiveDesc primitive = CreatePrimitive(CSGShapes::Prism);
+        primitive.dimensions[1] = height;
+        primitive.firstPoint = static_cast<int>(firstPoint);
+        primitive.numPoints = static_cast<int>((points.size() / 2) - firstPoint);
+        AddPrimitive(primitive, ShapeOperations::Union, outPrimitives, outOperations);
+    }
+
+    // Appends one side of a wall path, offset by side: half the thickness to the left, or negative to the right. At a corner the
+    // side on the outside is mitred, and the side on the inside is pinched in to the path's own point, where it overlaps the
+    // rest of the wall. Each segment's offset line, plus the corner pieces, traces out the same region as a union of one
+    // rectangle per segment and one wedge per corner.
+    void AddWallSide(const std::vector<double>& path, const std::vector<double>& directions, bool isClosed, double side,
+        std::vector<double>& outPoints)
+    {
+        const size_t numPathPoints = isClosed ? directions.size() / 2 : (directions.size() / 2) + 1;
+        const size_t numSegments = directions.size() / 2;
+
+        // Open ends reach half the thickness past their point to square them off.
+        if (!isClosed)
+        {
+            const double extend = std::abs(side);
+            outPoints.push_back(path[0] - (directions[0] * extend) - (directions[1] * side));
+            outPoints.push_back(path[1] - (directions[1] * extend) + (directions[0] * side));
+        }
+
+        const size_t firstCorner = isClosed ? 0 : 1;
+        const size_t endCorner = isClosed ? numPathPoints : numPathPoints - 1;
+        for (size_t i = firstCorner; i < endCorner; ++i)
+        {
+            const double* in = &directions[((i + numSegments - 1) % numSegments) * 2];
+            const double* out = &directions[(i % numSegments) * 2];
+            const double cornerX = path[i * 2];
+            const double cornerZ = path[(i * 2) + 1];
+            const double inSideX = cornerX - (in[1] * side);
+            const double inSideZ = cornerZ + (in[0] * side);
+            const double outSideX = cornerX - (out[1] * side);
+            const double outSideZ = cornerZ + (out[0] * side);
+
+            // The outside of the corner is the side the path turns away from.
+            double cross = (in[0] * out[1]) - (in[1] * out[0]);
+            double dot = (in[0] * out[0]) + (in[1] * out[1]);
+            if (std::abs(cross) < 1e-9 && dot > 0.0)
+            {
+                outPoints.push_back(outSideX); // Straight on, so the two segments' ends meet.
+                outPoints.push_back(outSideZ);
+                continue;
+            }
+
+            outPoints.push_back(inSideX);
+            outPoints.push_back(inSideZ);
+            if (std::abs(cross) < 1e-9 || (cross > 0.0) == (side > 0.0))
+            {
+                // Doubling straight back has no outside, so both sides are squared off at the point.
+                outPoints.push_back(cornerX);
+                outPoints.push_back(cornerZ);
+            }
+            else
+            {
+                // Mitre the corner out along the average of the two normals, far enough to stay the full thickness from both.
+                // Very sharp corners are bevelled instead, to keep the mitre from reaching far past the wall.
+                double normalX = -(in[1] + out[1]);
+                double normalZ = in[0] + out[0];
+                double length = std::sqrt((normalX * normalX) + (normalZ * normalZ));
+                double cosine = ((normalX * -in[1]) + (normalZ * in[0])) / length;
+                if (cosine >= s_MinMitreCosine)
+                {
+                    double mitre = side / (cosine * length);
+                    outPoints.push_back(cornerX + (normalX * mitre));
+                    outPoints.push_back(cornerZ + (normalZ * mitre));
+                }
+            }
+            outPoints.push_back(outSideX);
+            outPoints.push_back(outSideZ);
+        }
+
+        if (!isClosed)
+        {
+            const double* last = &directions[(numSegments - 1) * 2];
+            const double extend = std::abs(side);
+            outPoints.push_back(path[path.size() - 2] + (last[0] * extend) - (last[1] * side));
+            outPoints.push_back(path[path.size() - 1] + (last[1] * extend) + (last[0] * side));
+        }
+    }
+
+    // Each wall is a single prism, whose outline runs along the left of its path and back along the right. The outline
+    // overlaps itself on the inside of every corner, and wherever the path crosses itself, but prisms fill by the nonzero
+    // winding rule, so the overlaps stay solid. A closed path gives two rings instead, the right one wound the other way so
+    // that it is a hole in the left one.
+    void DescribeWall(const BuildingLevelDesc& level, const int* points, int numPoints,
+        std::vector<CSGPrimitiveDesc>& outPrimitives, std::vector<int>& outOperations, std::vector<double>& outPoints)
+    {
+        // Repeated points would have no direction, so drop them.
+        std::vector<double> path;
+        path.reserve(numPoints * 2);
+        for (int i = 0; i < numPoints; ++i)
+        {
+            if (i == 0 || points[i * 2] != points[(i - 1) * 2] || points[(i * 2) + 1] != points[((i - 1) * 2) + 1])
+            {
+                path.push_back(points[i * 2]);
+                path.push_back(points[(i * 2) + 1]);
+            }
+        }
+
+        size_t numPathPoints = path.size() / 2;
+        bool isClosed = numPathPoints > 3 && path[0] == path[path.size() - 2] && path[1] == path[path.size() - 1];
+        if (isClosed)
+        {
+            --numPathPoints;
+            path.resize(numPathPoints * 2);
+        }
+        if (numPathPoints < 2)
+        {
+            return;
+        }
+
+        // The unit direction of each segment, whose left hand normal is (-z, x). Segment i runs from point i to the next one.
+        const size_t numSegments = isClosed ? numPathPoints : numPathPoints - 1;
+        std::vector<double> directions(numSegments * 2);
+        for (size_t i = 0; i < numSegments; ++i)
+        {
+            size_t next = (i + 1) % numPathPoints;
+            double directionX = path[next * 2] - path[i * 2];
+            double directionZ = path[(next * 2) + 1] - path[(i * 2) + 1];
+            double length = std::sqrt((directionX * directionX) + (directionZ * directionZ));
+            directions[i * 2] = directionX / length;
+            directions[(i * 2) + 1] = directionZ / length;
+        }
+
+        const double halfThickness = level.wallThickness * 0.5;
+        const size_t firstPoint = outPoints.size() / 2;
+        AddWallSide(path, directions, isClosed, halfThickness, outPoints);
+        if (isClosed)
+        {
+            // Return to the ring's first point to end it.
+            outPoints.push_back(outPoints[firstPoint * 2]);
+            outPoints.push_back(outPoints[(firstPoint * 2) + 1]);
+        }
+
+        // The right side runs back the other way.
+        const size_t rightSide = outPoints.size() / 2;
+        AddWallSide(path, directions, isClosed, -halfThickness, outPoints);
+        for (size_t i = rightSide, j = (outPoints.size() / 2) - 1; i < j; ++i, --j)
+        {
+            std::swap(outPoints[i * 2], outPoints[j * 2]);
+            std::swap(outPoints[(i * 2) + 1], outPoints[(j * 2) + 1]);
+        }
+
+        AddPrism(firstPoint, level.wallHeight, outPrimitives, outOperations, outPoints);
+    }
+
+    void DescribeFloor(const BuildingLevelDesc& level, const int* points, int numPoints,
+        std::vector<CSGPrimitiveDesc>& outPrimitives, std::vector<int>& outOperations, std::vector<double>& outPoints)
+    {
+        if (numPoints < 3)
+        {
+            return;
+        }
+
+        size_t firstPoint = outPoints.size() / 2;
+        outPoints.insert(outPoints.end(), points, points + (numPoints * 2));
+
+        AddPrism(firstPoint, level.floorThickness, outPrimitives, outOperations, outPoints);
+    }
+}
+
+void DescribeBuildingLevel(const BuildingLevelDesc& level,
+    std::vector<CSGPrimitiveDesc>& outPrimitives, std::vector<int>& outOperations, std::vector<double>& outPoints)
+{
+    // A wall is one prism of at most three points per path point on each side, plus one to end its first ring. A floor is one
+    // prism of exactly its points.
+    size_t numWallPoints = 0;
+    for (int i = 0; i < level.numWalls; ++i)
+    {
+        numWallPoints += static_cast<size_t>(level.wallPointCounts[i]);
+    }
+    size_t numFloorPoints = 0;
+    for (int i = 0; i < level.numFloors; ++i)
+    {
+        numFloorPoints += static_cast<size_t>(level.floorPointCounts[i]);
+    }
+
+    const size_t numPrimitives = static_cast<size_t>(level.numWalls) + static_cast<size_t>(level.numFloors);
+    outPrimitives.reserve(outPrimitives.size() + numPrimitives);
+    outOperations.reserve(outOperations.size() + (numPrimitives * 2));
+    outPoints.reserve(outPoints.size() + (((numWallPoints * 6) + static_cast<size_t>(level.numWalls) + numFloorPoints) * 2));
+
+    const int* wallPoints = level.wallPoints;
+    for (int i = 0; i < level.numWalls; ++i)
+    {
+        DescribeWall(level, wallPoints, level.wallPointCounts[i], outPrimitives, outOperations, outPoints);
+        wallPoints += level.wallPointCounts[i] * 2;
+    }
+
+    const int* floorPoints = level.floorPoints;
+    for (int i = 0; i < level.numFloors; ++i)
+    {
+        DescribeFloor(level, floorPoints, level.floorPointCounts[i], outPrimitives, outOperations, outPoints);
+        floorPoints += level.floorPointCounts[i] * 2;
+    }
+}
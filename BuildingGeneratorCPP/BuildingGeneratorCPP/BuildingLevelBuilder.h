@@ -0,0 +1,34 @@
+// Turns the walls and floors of a BuildingBlueprint level into a composite shape description.
+
+#pragma once
+
+#ifndef INCLUDED_BUILDING_LEVEL_BUILDER_H
+#define INCLUDED_BUILDING_LEVEL_BUILDER_H
+
+#include "CompositeShapeDesc.h"
+
+#include <vector>
+
+// Mirrors BuildingBlueprint.Level. Points are the blueprint's IntTuple2s, flattened to x, z pairs.
+struct BuildingLevelDesc
+{
+    double wallHeight;
+    double wallThickness;
+    double floorThickness;
+
+    const int* wallPoints; // Every wall's points back to back.
+    const int* wallPointCounts; // The number of points in each wall.
+    int numWalls;
+
+    const int* floorPoints; // Every floor's outline back to back.
+    const int* floorPointCounts; // The number of points in each floor.
+    int numFloors;
+};
+
+// Appends prisms for the walls and floors, plus a postorder union of all of them. Each wall is one prism, outlining its path
+// with mitred corners. Walls stand on y = 0 and reach half their thickness past their end points.
+// Floor slabs fill y = 0 to the floor thickness.
+void DescribeBuildingLevel(const BuildingLevelDesc& level,
+    std::vector<CSGPrimitiveDesc>& outPrimitives, std::vector<int>& outOperations, std::vector<double>& outPoints);
+
+#endif // INCLUDED_BUILDING_LEVEL_BUILDER_H
@@ -0,0 +1,30 @@
+
+#include "CompositeInstance.h"
+#include "CompositeShape.h"
+#include "Quaternion.h"
+
+CSGCompositeInstance::CSGCompositeInstance(const std::shared_ptr<const CompositeShape>& composite, const Vector4& position, const Quaternion& orientation)
+    : m_composite(composite)
+    , m_outerToInstanceMatrix()
+    , m_bounds()
+{
+    Matrix4x4 instanceToOuter(position, orientation);
+    m_outerToInstanceMatrix = instanceToOuter.CalcInverseTransform();
+    m_bounds = composite->CalcBounds().CalcTransformed(instanceToOuter);
+}
+
+void CSGCompositeInstance::Transform(const Matrix4x4& transform)
+{
+    Matrix4x4 instanceToOuter = transform * m_outerToInstanceMatrix.CalcInverseTransform();
+    m_outerToInstanceMatrix = instanceToOuter.CalcInverseTransform();
+    m_bounds = m_composite->CalcBounds().CalcTransformed(instanceToOuter);
+}
+
+bool CSGCompositeInstance::Contains(const Vector4& point) const
+{
+    if (!m_bounds.Contains(point))
+    {
+        return false;
+    }
+    return m_composite->Contains(m_outerToInstanceMatrix.TransformPoint(point));
+}
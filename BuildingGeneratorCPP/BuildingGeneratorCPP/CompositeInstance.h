@@ -0,0 +1,40 @@
+// One placement of a composite inside another, so that repeated structures such as staircases are stored once.
+
+#pragma once
+
+#ifndef INCLUDED_COMPOSITE_INSTANCE_H
+#define INCLUDED_COMPOSITE_INSTANCE_H
+
+#include "BoundingBox.h"
+#include "Matrix4x4.h"
+#include "Vector4.h"
+
+#include <memory>
+
+class CompositeShape;
+class Quaternion;
+
+// The placed composite is shared between all of its placements, so it must not change while it is placed.
+class CSGCompositeInstance
+{
+public:
+    CSGCompositeInstance(const std::shared_ptr<const CompositeShape>& composite, const Vector4& position, const Quaternion& orientation);
+
+    // Points outside the cached bounds are rejected without looking at the placed composite at all. Composites walk their own
+    // placements without calling this, applying each placement's inverse transform on the way down, so nested placements
+    // form a stack of transforms without any matrices being combined.
+    bool Contains(const Vector4& point) const;
+
+    const BoundingBox& GetBounds() const { return m_bounds; } // In the space of the composite it is placed in.
+    const CompositeShape& GetComposite() const { return *m_composite; }
+    const Matrix4x4& GetOuterToInstanceMatrix() const { return m_outerToInstanceMatrix; }
+
+    void Transform(const Matrix4x4& transform); // Moves the placement by a rigid transformation of the outer composite's space.
+
+private:
+    std::shared_ptr<const CompositeShape> m_composite;
+    Matrix4x4 m_outerToInstanceMatrix; // Cached so that placing a composite doesn't add a matrix inverse to every query.
+    BoundingBox m_bounds;
+};
+
+#endif // INCLUDED_COMPOSITE_INSTANCE_H
@@ -0,0 +1,99 @@
+
+#include "CompositeLODChain.h"
+#include "CompositeMesher.h"
+#include "CompositeShape.h"
+#include "MemoryResource.h"
+#include "MeshChunkRing.h"
+
+CompositeLODChain::CompositeLODChain()
+    : CompositeLODChain(GetDefaultMemoryResource())
+{
+}
+
+CompositeLODChain::CompositeLODChain(MemoryResource* resource)
+    : m_levels(resource)
+    , m_sourceVersion(0)
+    , m_baseVoxelSize(0.0)
+{
+}
+
+void CompositeLODChain::Generate(const CompositeShape& source, double baseVoxelSize, size_t numLevels)
+{
+    m_levels.clear();
+    m_levels.resize(numLevels, LODLevel(m_levels.get_allocator().GetResource()));
+    m_sourceVersion = source.GetVersion();
+    m_baseVoxelSize = baseVoxelSize;
+
+    // Every level meshes the same region so the levels line up with each other.
+    BoundingBox bounds = source.CalcBounds();
+    if (bounds.IsEmpty())
+    {
+        return;
+    }
+
+    // The simplified composites only live for the duration of their level, so they come from an arena that is reset each time.
+    MonotonicMemoryResource scratch(s_ScratchBlockSize, GetDefaultMemoryResource());
+
+    double voxelSize = baseVoxelSize;
+    for (size_t i = 0; i < numLevels; ++i, voxelSize *= 2.0)
+    {
+        LODLevel& level = m_levels[i];
+        level.voxelSize = voxelSize;
+
+        MeshChunkRing ring(1);
+        ring.SetReadyCallback(&CopyChunk, &level);
+
+        if (i == 0)
+        {
+            CompositeMesher mesher(source, bounds.minCorner, bounds.CalcSize(), voxelSize);
+            mesher.Run(ring);
+        }
+        else
+        {
+            // Anything under two voxels across can't be represented cleanly at this level.
+            {
+                CompositeShape simplified = source.CreateSimplified(voxelSize * 2.0, &scratch);
+                CompositeMesher mesher(simplified, bounds.minCorner, bounds.CalcSize(), voxelSize);
+                mesher.Run(ring);
+            }
+            scratch.Release();
+        }
+    }
+}
+
+bool CompositeLODChain::IsCurrent(const CompositeShape& source, double baseVoxelSize, size_t numLevels) const
+{
+    return !m_levels.empty()
+        && m_sourceVersion == source.GetVersion()
+        && m_baseVoxelSize == baseVoxelSize
+        && m_levels.size() == numLevels;
+}
+
+void CompositeLODChain::CalcMemoryUsage(CompositeMemoryUsage& inOutUsage) const
+{
+    inOutUsage.caches += m_levels.capacity() * sizeof(LODLevel);
+
+    for (const LODLevel& level : m_levels)
+    {
+        inOutUsage.caches += level.chunks.capacity() * sizeof(LODMeshChunk);
+
+        for (const LODMeshChunk& chunk : level.chunks)
+        {
+            inOutUsage.meshes += (chunk.vertices.capacity() + chunk.normals.capacity()) * sizeof(float);
+            inOutUsage.meshes += chunk.triangles.capacity() * sizeof(int);
+        }
+    }
+}
+
+void CompositeLODChain::CopyChunk(const MeshChunk& chunk, void* userData)
+{
+    LODLevel& level = *static_cast<LODLevel*>(userData);
+
+    level.chunks.push_back(LODMeshChunk(level.chunks.get_allocator().GetResource()));
+    LODMeshChunk& copy = level.chunks.back();
+
+    const size_t numFloats = chunk.NumVertices() * 3;
+    copy.vertices.assign(chunk.GetVertices(), chunk.GetVertices() + numFloats);
+    copy.normals.assign(chunk.GetNormals(), chunk.GetNormals() + numFloats);
+    copy.triangles.assign(chunk.GetTriangles(), chunk.GetTriangles() + chunk.NumIndices());
+}
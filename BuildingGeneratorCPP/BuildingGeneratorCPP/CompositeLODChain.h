@@ -0,0 +1,70 @@
+// A chain of progressively coarser meshes generated from a single composite shape. Level 0 is full detail.
+
+#pragma once
+
+#ifndef INCLUDED_COMPOSITE_LOD_CHAIN_H
+#define INCLUDED_COMPOSITE_LOD_CHAIN_H
+
+#include "MemoryResource.h"
+
+#include <cstddef>
+
+class CompositeShape;
+class MeshChunk;
+
+class CompositeLODChain
+{
+public:
+    // A right-sized copy of a mesh chunk. Cached chunks outlive the mesher, so they can't stay in its ring.
+    struct LODMeshChunk
+    {
+        explicit LODMeshChunk(MemoryResource* resource)
+            : vertices(resource)
+            , normals(resource)
+            , triangles(resource)
+        {
+        }
+
+        ResourceVector<float> vertices; // Packed x, y, z.
+        ResourceVector<float> normals; // Packed x, y, z.
+        ResourceVector<int> triangles;
+    };
+
+    struct LODLevel
+    {
+        explicit LODLevel(MemoryResource* resource)
+            : voxelSize(0.0)
+            , chunks(resource)
+        {
+        }
+
+        double voxelSize;
+        ResourceVector<LODMeshChunk> chunks;
+    };
+
+    CompositeLODChain();
+    explicit CompositeLODChain(MemoryResource* resource); // The levels and their meshes come from the resource, which must outlive the chain.
+
+    // Each level doubles the voxel size of the one before it. Coarser levels also drop Difference operands that would be
+    // less than two voxels across, and merge unioned cuboids and prisms.
+    void Generate(const CompositeShape& source, double baseVoxelSize, size_t numLevels);
+
+    // Whether this chain was generated from the composite as it is now, with the same settings.
+    bool IsCurrent(const CompositeShape& source, double baseVoxelSize, size_t numLevels) const;
+
+    size_t NumLevels() const { return m_levels.size(); }
+    const LODLevel& GetLevel(size_t index) const { return m_levels[index]; }
+
+    void CalcMemoryUsage(CompositeMemoryUsage& inOutUsage) const; // Adds the meshes, plus the levels holding them as caches.
+
+private:
+    static void CopyChunk(const MeshChunk& chunk, void* userData);
+
+    static const size_t s_ScratchBlockSize = 64 * 1024;
+
+    ResourceVector<LODLevel> m_levels;
+    unsigned int m_sourceVersion;
+    double m_baseVoxelSize;
+};
+
+#endif // INCLUDED_COMPOSITE_LOD_CHAIN_H
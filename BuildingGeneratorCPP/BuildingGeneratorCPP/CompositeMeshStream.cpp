@@ -0,0 +1,18 @@
+
+#include "CompositeMeshStream.h"
+
+CompositeMeshStream::CompositeMeshStream(const CompositeShape& composite, const Vector4& origin, const Vector4& dimensions, double voxelSize, size_t numChunks)
+    : m_mesher(composite, origin, dimensions, voxelSize)
+    , m_ring(numChunks)
+    , m_worker([this]() { m_mesher.Run(m_ring); })
+{
+}
+
+CompositeMeshStream::~CompositeMeshStream()
+{
+    m_ring.Cancel();
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+}
@@ -0,0 +1,31 @@
+// Runs a composite mesher on a worker thread so the consumer can upload chunks while later ones are still being generated.
+
+#pragma once
+
+#ifndef INCLUDED_COMPOSITE_MESH_STREAM_H
+#define INCLUDED_COMPOSITE_MESH_STREAM_H
+
+#include "CompositeMesher.h"
+#include "MeshChunkRing.h"
+
+#include <thread>
+
+class CompositeMeshStream
+{
+public:
+    // Peak memory is bounded by numChunks, no matter how large the composite is.
+    CompositeMeshStream(const CompositeShape& composite, const Vector4& origin, const Vector4& dimensions, double voxelSize, size_t numChunks);
+    ~CompositeMeshStream(); // Cancels meshing if it is still running and waits for the worker to stop.
+
+    MeshChunkRing& GetRing() { return m_ring; }
+
+private:
+    CompositeMeshStream(const CompositeMeshStream&); // Not copyable; the worker thread refers to this stream.
+    void operator=(const CompositeMeshStream&);
+
+    CompositeMesher m_mesher;
+    MeshChunkRing m_ring;
+    std::thread m_worker; // Declared last so everything it uses exists before it starts.
+};
+
+#endif // INCLUDED_COMPOSITE_MESH_STREAM_H
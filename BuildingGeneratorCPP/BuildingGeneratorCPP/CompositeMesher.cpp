@@ -0,0 +1,186 @@
+
+#include "CompositeMesher.h"
+#include "CompositeShape.h"
+#include "MeshChunkRing.h"
+#include "DebugUtils.h"
+
+#include <cmath>
+
+namespace
+{
+    // Samples include a one voxel border around the brick so faces on the brick's edge can see their neighbours.
+    const int s_SampleSpan = CompositeMesher::s_BrickSize + 2;
+
+    inline size_t SampleIndex(int x, int y, int z) // Brick local voxel coordinates, from -1 to s_BrickSize inclusive.
+    {
+        return static_cast<size_t>(((z + 1) * s_SampleSpan * s_SampleSpan) + ((y + 1) * s_SampleSpan) + (x + 1));
+    }
+}
+
+CompositeMesher::CompositeMesher(const CompositeShape& composite, const Vector4& origin, const Vector4& dimensions, double voxelSize)
+    : m_composite(composite)
+    , m_origin(origin)
+    , m_voxelSize(voxelSize)
+{
+    dbAssertf(voxelSize <= 0.0, "Invalid voxel size %f", voxelSize);
+
+    const double extents[3] = { dimensions.x, dimensions.y, dimensions.z };
+    for (size_t i = 0; i < 3; ++i)
+    {
+        m_numVoxels[i] = static_cast<int>(std::ceil(extents[i] / voxelSize));
+        m_numBricks[i] = (m_numVoxels[i] + s_BrickSize - 1) / s_BrickSize;
+    }
+}
+
+bool CompositeMesher::Run(MeshChunkRing& ring) const
+{
+    std::vector<char> samples(s_SampleSpan * s_SampleSpan * s_SampleSpan);
+
+    MeshChunk* chunk = ring.AcquireEmpty();
+    if (chunk == nullptr)
+    {
+        return false;
+    }
+
+    for (int z = 0; z < m_numBricks[2]; ++z)
+    {
+        for (int y = 0; y < m_numBricks[1]; ++y)
+        {
+            for (int x = 0; x < m_numBricks[0]; ++x)
+            {
+                SampleBrick(x, y, z, samples);
+                if (!MeshBrick(x, y, z, samples, ring, chunk))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Hand off whatever is left over in the last chunk.
+    if (!chunk->IsEmpty())
+    {
+        ring.Submit(chunk);
+    }
+    ring.Finish();
+    return true;
+}
+
+void CompositeMesher::SampleBrick(int brickX, int brickY, int brickZ, std::vector<char>& outSamples) const
+{
+    const int first[3] = { brickX * s_BrickSize, brickY * s_BrickSize, brickZ * s_BrickSize };
+
+    for (int z = -1; z <= s_BrickSize; ++z)
+    {
+        int voxelZ = first[2] + z;
+        for (int y = -1; y <= s_BrickSize; ++y)
+        {
+            int voxelY = first[1] + y;
+            for (int x = -1; x <= s_BrickSize; ++x)
+            {
+                int voxelX = first[0] + x;
+
+                // Everything outside the region is empty, which closes off shapes that poke out of it.
+                bool inRegion = (voxelX >= 0 && voxelX < m_numVoxels[0])
+                    && (voxelY >= 0 && voxelY < m_numVoxels[1])
+                    && (voxelZ >= 0 && voxelZ < m_numVoxels[2]);
+
+                bool contained = false;
+                if (inRegion)
+                {
+                    Vector4 center(
+                        m_origin.x + ((voxelX + 0.5) * m_voxelSize),
+                        m_origin.y + ((voxelY + 0.5) * m_voxelSize),
+                        m_origin.z + ((voxelZ + 0.5) * m_voxelSize),
+                        1.0);
+                    contained = m_composite.Contains(center);
+                }
+                outSamples[SampleIndex(x, y, z)] = contained ? 1 : 0;
+            }
+        }
+    }
+}
+
+bool CompositeMesher::MeshBrick(int brickX, int brickY, int brickZ, const std::vector<char>& samples, MeshChunkRing& ring, MeshChunk*& inOutChunk) const
+{
+    const int first[3] = { brickX * s_BrickSize, brickY * s_BrickSize, brickZ * s_BrickSize };
+    const float voxelSize = static_cast<float>(m_voxelSize);
+
+    for (int z = 0; z < s_BrickSize; ++z)
+    {
+        for (int y = 0; y < s_BrickSize; ++y)
+        {
+            for (int x = 0; x < s_BrickSize; ++x)
+            {
+                if (samples[SampleIndex(x, y, z)] == 0)
+                {
+                    continue;
+                }
+
+                const int local[3] = { x, y, z };
+                const float minCorner[3] = {
+                    static_cast<float>(m_origin.x + ((first[0] + x) * m_voxelSize)),
+                    static_cast<float>(m_origin.y + ((first[1] + y) * m_voxelSize)),
+                    static_cast<float>(m_origin.z + ((first[2] + z) * m_voxelSize)) };
+
+                // Emit a face toward every empty neighbour.
+                for (int axis = 0; axis < 3; ++axis)
+                {
+                    for (int sign = -1; sign <= 1; sign += 2)
+                    {
+                        int neighbour[3] = { local[0], local[1], local[2] };
+                        neighbour[axis] += sign;
+                        if (samples[SampleIndex(neighbour[0], neighbour[1], neighbour[2])] != 0)
+                        {
+                            continue;
+                        }
+
+                        if (!inOutChunk->CanFitQuad())
+                        {
+                            ring.Submit(inOutChunk);
+                            inOutChunk = ring.AcquireEmpty();
+                            if (inOutChunk == nullptr)
+                            {
+                                return false;
+                            }
+                        }
+
+                        // Walking u then v around the face gives a clockwise winding seen from the +axis side, so swap them for the -axis side.
+                        int u = (axis + 1) % 3;
+                        int v = (axis + 2) % 3;
+                        if (sign < 0)
+                        {
+                            int swap = u;
+                            u = v;
+                            v = swap;
+                        }
+
+                        float corners[4][3];
+                        for (size_t c = 0; c < 4; ++c)
+                        {
+                            for (size_t i = 0; i < 3; ++i)
+                            {
+                                corners[c][i] = minCorner[i];
+                            }
+                            if (sign > 0)
+                            {
+                                corners[c][axis] += voxelSize;
+                            }
+                        }
+                        corners[1][u] += voxelSize;
+                        corners[2][u] += voxelSize;
+                        corners[2][v] += voxelSize;
+                        corners[3][v] += voxelSize;
+
+                        float normal[3] = { 0.0f, 0.0f, 0.0f };
+                        normal[axis] = static_cast<float>(sign);
+
+                        inOutChunk->AddQuad(corners, normal);
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,40 @@
+// Extracts the surface of a composite shape on a voxel grid and streams it out in bounded mesh chunks.
+
+#pragma once
+
+#ifndef INCLUDED_COMPOSITE_MESHER_H
+#define INCLUDED_COMPOSITE_MESHER_H
+
+#include "Vector4.h"
+
+#include <vector>
+
+class CompositeShape;
+class MeshChunk;
+class MeshChunkRing;
+
+class CompositeMesher
+{
+public:
+    // The grid is processed one brick at a time so that only a brick's worth of containment samples is ever held in memory.
+    static const int s_BrickSize = 16;
+
+    // The region is the axis aligned box starting at origin with the given dimensions. Both are treated as 3D vectors.
+    CompositeMesher(const CompositeShape& composite, const Vector4& origin, const Vector4& dimensions, double voxelSize);
+
+    // Fills chunks from the ring, submitting each as soon as it is full, and finishes the ring when done.
+    // Returns false if the ring was cancelled before meshing completed. The composite must not change while this runs.
+    bool Run(MeshChunkRing& ring) const;
+
+private:
+    void SampleBrick(int brickX, int brickY, int brickZ, std::vector<char>& outSamples) const;
+    bool MeshBrick(int brickX, int brickY, int brickZ, const std::vector<char>& samples, MeshChunkRing& ring, MeshChunk*& inOutChunk) const;
+
+    const CompositeShape& m_composite;
+    Vector4 m_origin; // Treated as a 3D vector.
+    double m_voxelSize;
+    int m_numVoxels[3];
+    int m_numBricks[3];
+};
+
+#endif // INCLUDED_COMPOSITE_MESHER_H
@@ -1,134 +1,1744 @@
 
 #include "CompositeShape.h"
 #include "DebugUtils.h"
+#include "Quaternion.h"
+#include "ShapePrimitives/BuildingModules.h"
 
-#include <stack>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Operands that never settled a run while profiling still get ranked by their cost, as if they settled it this often.
+    const double s_MinSettleChance = 1e-3;
+
+    // Containment tests through trees nested deeper than this spill their stack onto the heap.
+    const size_t s_ContainsStackSize = 64;
+
+    // A stack that stays in its fixed buffer until it outgrows it, so walking a shallow tree costs no allocation while a long
+    // chain still can't overflow the call stack.
+    template <typename T, size_t Capacity>
+    class InlineStack
+    {
+    public:
+        InlineStack()
+            : m_size(0)
+        {
+        }
+
+        bool IsEmpty() const { return m_size == 0; }
+        T& Top() { return (m_size <= Capacity) ? m_fixed[m_size - 1] : m_spilled.back(); }
+
+        void Push(const T& value)
+        {
+            if (m_size < Capacity)
+            {
+                m_fixed[m_size] = value;
+            }
+            else
+            {
+                m_spilled.push_back(value);
+            }
+            ++m_size;
+        }
+
+        void Pop()
+        {
+            if (m_size > Capacity)
+            {
+                m_spilled.pop_back();
+            }
+            --m_size;
+        }
+
+    private:
+        T m_fixed[Capacity];
+        std::vector<T> m_spilled;
+        size_t m_size;
+    };
+
+    // A module created while building, so later placements with the same measurements can share it.
+    struct BuiltModule
+    {
+        const CSGPrimitiveDesc* primitive;
+        std::shared_ptr<const CSGModuleBase> module;
+    };
+
+    std::shared_ptr<const CSGModuleBase> FindOrCreateModule(const CSGPrimitiveDesc& primitive, std::vector<BuiltModule>& inOutBuiltModules)
+    {
+        for (const BuiltModule& built : inOutBuiltModules)
+        {
+            if (built.primitive->moduleType == primitive.moduleType
+                && std::equal(primitive.dimensions, primitive.dimensions + 3, built.primitive->dimensions)
+                && std::equal(primitive.moduleParameters, primitive.moduleParameters + 6, built.primitive->moduleParameters))
+            {
+                return built.module;
+            }
+        }
+
+        BuiltModule built;
+        built.primitive = &primitive;
+        built.module = CreateBuildingModule(static_cast<BuildingModuleType>(primitive.moduleType), primitive.dimensions, primitive.moduleParameters);
+        if (built.module)
+        {
+            inOutBuiltModules.push_back(built);
+        }
+        return built.module;
+    }
+}
 
 CompositeShape::CompositeShape()
-    : m_shapes()
-    , m_nodes()
+    : CompositeShape(GetDefaultMemoryResource())
+{
+}
+
+CompositeShape::CompositeShape(MemoryResource* resource)
+    : m_shapes(resource)
+    , m_nodes(resource)
+    , m_modules(resource)
+    , m_composites(resource)
+    , m_prisms(resource)
+    , m_root(s_InvalidIndex)
+    , m_version(0)
     , m_position()
 {
 }
 
-bool CompositeShape::Contains(const Vector4& point) const
+bool CompositeShape::Contains(const Vector4& point) const
+{
+    if (m_root == s_InvalidIndex)
+    {
+        return false;
+    }
+    return NodeContains(m_root, point);
+}
+
+double CompositeShape::CalcVolume(double sampleSpacing) const
+{
+    if (m_root == s_InvalidIndex)
+    {
+        return 0.0;
+    }
+
+    std::vector<size_t> postorder;
+    postorder.reserve(m_nodes.size());
+    CollectPostorder(m_root, postorder);
+
+    std::vector<BoundingBox> nodeBounds(m_nodes.size());
+    FillNodeBounds(m_root, nodeBounds);
+
+    if (!(sampleSpacing > 0.0))
+    {
+        double smallestExtent = 0.0;
+        for (size_t nodeIndex : postorder)
+        {
+            if (m_nodes[nodeIndex].operation != ShapeOperations::Shape)
+            {
+                continue;
+            }
+
+            Vector4 size = nodeBounds[nodeIndex].CalcSize();
+            const double extents[3] = { size.x, size.y, size.z };
+            for (double extent : extents)
+            {
+                if (extent > 0.0 && (smallestExtent == 0.0 || extent < smallestExtent))
+                {
+                    smallestExtent = extent;
+                }
+            }
+        }
+        sampleSpacing = smallestExtent / s_VolumeSamplesPerPrimitive;
+        if (!(sampleSpacing > 0.0))
+        {
+            return 0.0; // Every primitive is flat.
+        }
+    }
+
+    // Each operation's volume follows from its operands' volumes and the volume they share. That is only sampled where the
+    // bounds of a leaf from each side meet, and only if the operands may actually overlap.
+    std::vector<double> volumes(m_nodes.size(), 0.0);
+    std::vector<BoundingBox> leftRegions;
+    std::vector<BoundingBox> sharedRegions;
+    for (size_t nodeIndex : postorder)
+    {
+        const CompositeNode& node = m_nodes[nodeIndex];
+
+        if (node.operation == ShapeOperations::Shape)
+        {
+            const ShapeUnion& shape = m_shapes[node.shape];
+            switch (shape.shapeType)
+            {
+            case CSGShapes::Cuboid:
+                volumes[nodeIndex] = shape.cuboid.CalcVolume();
+                break;
+            case CSGShapes::Module:
+                sharedRegions.assign(1, nodeBounds[nodeIndex]);
+                volumes[nodeIndex] = SampleVolume(sharedRegions, nodeIndex, s_InvalidIndex, sampleSpacing);
+                break;
+            case CSGShapes::Composite:
+                volumes[nodeIndex] = m_composites[shape.composite].GetComposite().CalcVolume(sampleSpacing); // Placing doesn't scale.
+                break;
+            case CSGShapes::Prism:
+                volumes[nodeIndex] = m_prisms[shape.prism].CalcVolume();
+                break;
+            default:
+                dbLogf("Invalid shape type %d", shape.shapeType);
+                break;
+            }
+            continue;
+        }
+
+        double sharedVolume = 0.0;
+        if (NodeOverlaps(node.left, nodeBounds, *this, node.right, nodeBounds))
+        {
+            leftRegions.clear();
+            CollectLeafRegions(node.left, nodeBounds[node.right], nodeBounds, leftRegions);
+
+            sharedRegions.clear();
+            for (const BoundingBox& leftRegion : leftRegions)
+            {
+                CollectLeafRegions(node.right, leftRegion, nodeBounds, sharedRegions);
+            }
+            sharedVolume = SampleVolume(sharedRegions, node.left, node.right, sampleSpacing);
+        }
+
+        switch (node.operation)
+        {
+        case ShapeOperations::Union:
+            volumes[nodeIndex] = volumes[node.left] + volumes[node.right] - sharedVolume;
+            break;
+        case ShapeOperations::Difference:
+            volumes[nodeIndex] = volumes[node.left] - sharedVolume;
+            break;
+        case ShapeOperations::Intersection:
+            volumes[nodeIndex] = sharedVolume;
+            break;
+        default:
+            dbLogf("Invalid shape operation %d", node.operation);
+            break;
+        }
+        volumes[nodeIndex] = std::max(volumes[nodeIndex], 0.0); // Sampling error can't make anything negative.
+    }
+
+    return volumes[m_root];
+}
+
+void CompositeShape::CollectLeafRegions(size_t nodeIndex, const BoundingBox& box, const std::vector<BoundingBox>& nodeBounds,
+    std::vector<BoundingBox>& outRegions) const
+{
+    std::vector<size_t> pending(1, nodeIndex);
+    while (!pending.empty())
+    {
+        const size_t index = pending.back();
+        pending.pop_back();
+
+        BoundingBox region = nodeBounds[index].CalcIntersection(box);
+        Vector4 size = region.CalcSize();
+        if (region.IsEmpty() || size.x <= 0.0 || size.y <= 0.0 || size.z <= 0.0)
+        {
+            continue; // Nothing of the subtree inside the box has any volume.
+        }
+
+        const CompositeNode& node = m_nodes[index];
+        if (node.operation == ShapeOperations::Shape)
+        {
+            outRegions.push_back(region);
+        }
+        else
+        {
+            pending.push_back(node.right);
+            pending.push_back(node.left);
+        }
+    }
+}
+
+double CompositeShape::SampleVolume(const std::vector<BoundingBox>& regions, size_t nodeIndex, size_t otherNode, double sampleSpacing) const
+{
+    // Midpoint integration over each region, counting the points inside the node and, if there is one, the other node too.
+    // Regions may overlap, so points already covered by an earlier region are skipped. The regions are swept in order of
+    // their minimum x, so only those still active along x, and of those only the ones actually meeting the region, can
+    // already cover its points.
+    std::vector<size_t> order(regions.size());
+    for (size_t r = 0; r < regions.size(); ++r)
+    {
+        order[r] = r;
+    }
+    std::sort(order.begin(), order.end(), [&regions](size_t a, size_t b)
+    {
+        return regions[a].minCorner.x < regions[b].minCorner.x;
+    });
+
+    std::vector<size_t> active;
+    std::vector<size_t> neighbours;
+    double volume = 0.0;
+    for (size_t r : order)
+    {
+        const BoundingBox& region = regions[r];
+        const Vector4 size = region.CalcSize();
+        const double extents[3] = { size.x, size.y, size.z };
+        if (region.IsEmpty() || extents[0] <= 0.0 || extents[1] <= 0.0 || extents[2] <= 0.0)
+        {
+            continue;
+        }
+
+        // Nothing from here on starts before this region, so anything ending before it can't meet any of the rest.
+        active.erase(std::remove_if(active.begin(), active.end(), [&regions, &region](size_t earlier)
+        {
+            return regions[earlier].maxCorner.x < region.minCorner.x;
+        }), active.end());
+
+        neighbours.clear();
+        for (size_t earlier : active)
+        {
+            if (regions[earlier].Overlaps(region))
+            {
+                neighbours.push_back(earlier);
+            }
+        }
+        active.push_back(r);
+
+        int numCells[3];
+        double cellSize[3];
+        for (size_t i = 0; i < 3; ++i)
+        {
+            double numWanted = std::min(std::ceil(extents[i] / sampleSpacing), static_cast<double>(s_MaxVolumeSamplesPerAxis));
+            numCells[i] = std::max(static_cast<int>(numWanted), s_MinVolumeSamplesPerAxis);
+            cellSize[i] = extents[i] / numCells[i];
+        }
+
+        size_t numInside = 0;
+        for (int x = 0; x < numCells[0]; ++x)
+        {
+            for (int y = 0; y < numCells[1]; ++y)
+            {
+                for (int z = 0; z < numCells[2]; ++z)
+                {
+                    Vector4 sample(
+                        region.minCorner.x + ((x + 0.5) * cellSize[0]),
+                        region.minCorner.y + ((y + 0.5) * cellSize[1]),
+                        region.minCorner.z + ((z + 0.5) * cellSize[2]),
+                        1.0);
+
+                    bool coveredEarlier = false;
+                    for (size_t i = 0; i < neighbours.size() && !coveredEarlier; ++i)
+                    {
+                        coveredEarlier = regions[neighbours[i]].Contains(sample);
+                    }
+
+                    if (!coveredEarlier && NodeContains(nodeIndex, sample) && (otherNode == s_InvalidIndex || NodeContains(otherNode, sample)))
+                    {
+                        ++numInside;
+                    }
+                }
+            }
+        }
+        volume += numInside * cellSize[0] * cellSize[1] * cellSize[2];
+    }
+
+    return volume;
+}
+
+BoundingBox CompositeShape::CalcBounds() const
+{
+    if (m_root == s_InvalidIndex)
+    {
+        return BoundingBox();
+    }
+
+    std::vector<BoundingBox> nodeBounds(m_nodes.size());
+    FillNodeBounds(m_root, nodeBounds);
+    return nodeBounds[m_root];
+}
+
+bool CompositeShape::Overlaps(const CompositeShape& other) const
+{
+    if (m_root == s_InvalidIndex || other.m_root == s_InvalidIndex)
+    {
+        return false;
+    }
+
+    // Every node's bounds are needed for culling, so compute them all once up front.
+    std::vector<BoundingBox> nodeBounds(m_nodes.size());
+    FillNodeBounds(m_root, nodeBounds);
+
+    std::vector<BoundingBox> otherNodeBounds(other.m_nodes.size());
+    other.FillNodeBounds(other.m_root, otherNodeBounds);
+
+    return NodeOverlaps(m_root, nodeBounds, other, other.m_root, otherNodeBounds);
+}
+
+void CompositeShape::Union(const CSGCuboid& cuboid)
+{
+    ShapeUnion shapeUnion;
+    shapeUnion.shapeType = CSGShapes::Cuboid;
+    shapeUnion.cuboid = cuboid;
+    Combine(ShapeOperations::Union, shapeUnion);
+}
+
+void CompositeShape::Difference(const CSGCuboid& cuboid)
+{
+    ShapeUnion shapeUnion;
+    shapeUnion.shapeType = CSGShapes::Cuboid;
+    shapeUnion.cuboid = cuboid;
+    Combine(ShapeOperations::Difference, shapeUnion);
+}
+
+void CompositeShape::Intersection(const CSGCuboid& cuboid)
+{
+    ShapeUnion shapeUnion;
+    shapeUnion.shapeType = CSGShapes::Cuboid;
+    shapeUnion.cuboid = cuboid;
+    Combine(ShapeOperations::Intersection, shapeUnion);
+}
+
+void CompositeShape::Union(const CSGModuleInstance& module)
+{
+    Combine(ShapeOperations::Union, module);
+}
+
+void CompositeShape::Difference(const CSGModuleInstance& module)
+{
+    Combine(ShapeOperations::Difference, module);
+}
+
+void CompositeShape::Intersection(const CSGModuleInstance& module)
+{
+    Combine(ShapeOperations::Intersection, module);
+}
+
+void CompositeShape::Union(const CSGCompositeInstance& composite)
+{
+    Combine(ShapeOperations::Union, composite);
+}
+
+void CompositeShape::Difference(const CSGCompositeInstance& composite)
+{
+    Combine(ShapeOperations::Difference, composite);
+}
+
+void CompositeShape::Intersection(const CSGCompositeInstance& composite)
+{
+    Combine(ShapeOperations::Intersection, composite);
+}
+
+void CompositeShape::Union(const CSGPrism& prism)
+{
+    Combine(ShapeOperations::Union, prism);
+}
+
+void CompositeShape::Difference(const CSGPrism& prism)
+{
+    Combine(ShapeOperations::Difference, prism);
+}
+
+void CompositeShape::Intersection(const CSGPrism& prism)
+{
+    Combine(ShapeOperations::Intersection, prism);
+}
+
+bool CompositeShape::Build(const CompositeShapeDesc& desc, const std::shared_ptr<const CompositeShape>* placeableComposites, size_t numPlaceableComposites)
+{
+    const CSGPrimitiveDesc* primitives = desc.primitives;
+    const size_t numPrimitives = desc.numPrimitives;
+    const int* operations = desc.operations;
+    const size_t numOperations = desc.numOperations;
+
+    Clear();
+
+    if (numPrimitives == 0 && numOperations == 0)
+    {
+        return true; // Nothing describes an empty composite.
+    }
+
+    // A postorder list has exactly one node per entry, so this is the only allocation the tree needs.
+    m_shapes.reserve(numPrimitives);
+    m_nodes.reserve(numOperations);
+
+    size_t numModules = 0;
+    size_t numComposites = 0;
+    size_t numPrisms = 0;
+    for (size_t i = 0; i < numPrimitives; ++i)
+    {
+        CSGShapes shapeType = static_cast<CSGShapes>(primitives[i].shapeType);
+        numModules += (shapeType == CSGShapes::Module) ? 1 : 0;
+        numComposites += (shapeType == CSGShapes::Composite) ? 1 : 0;
+        numPrisms += (shapeType == CSGShapes::Prism) ? 1 : 0;
+    }
+    m_modules.reserve(numModules);
+    m_composites.reserve(numComposites);
+    m_prisms.reserve(numPrisms);
+
+    std::vector<BuiltModule> builtModules;
+    std::vector<size_t> operandStack;
+    operandStack.reserve(numPrimitives);
+    size_t nextPrimitive = 0;
+
+    for (size_t i = 0; i < numOperations; ++i)
+    {
+        ShapeOperations operation = static_cast<ShapeOperations>(operations[i]);
+
+        switch (operation)
+        {
+        case ShapeOperations::Shape:
+        {
+            if (nextPrimitive >= numPrimitives)
+            {
+                dbLogf("Operation %d needs more primitives than the %d given.", i, numPrimitives);
+                Clear();
+                return false;
+            }
+
+            const CSGPrimitiveDesc& primitive = primitives[nextPrimitive++];
+            Vector4 position(primitive.position[0], primitive.position[1], primitive.position[2], 1.0);
+            Quaternion orientation(primitive.orientation[0], primitive.orientation[1], primitive.orientation[2], primitive.orientation[3]);
+
+            ShapeUnion shapeUnion;
+            switch (static_cast<CSGShapes>(primitive.shapeType))
+            {
+            case CSGShapes::Cuboid:
+            {
+                shapeUnion.shapeType = CSGShapes::Cuboid;
+                shapeUnion.cuboid = CSGCuboid(position,
+                    Vector4(primitive.dimensions[0], primitive.dimensions[1], primitive.dimensions[2], 1.0),
+                    orientation);
+                break;
+            }
+            case CSGShapes::Module:
+            {
+                std::shared_ptr<const CSGModuleBase> module = FindOrCreateModule(primitive, builtModules);
+                if (!module)
+                {
+                    dbLogf("Primitive %d has unknown module type %d.", nextPrimitive - 1, primitive.moduleType);
+                    Clear();
+                    return false;
+                }
+
+                m_modules.push_back(CSGModuleInstance(module, position, orientation));
+                shapeUnion.shapeType = CSGShapes::Module;
+                shapeUnion.module = m_modules.size() - 1;
+                break;
+            }
+            case CSGShapes::Composite:
+            {
+                size_t placed = static_cast<size_t>(primitive.compositeID);
+                if (primitive.compositeID < 0 || placed >= numPlaceableComposites || placeableComposites[placed].get() == this)
+                {
+                    dbLogf("Primitive %d places composite %d, which isn't available.", nextPrimitive - 1, primitive.compositeID);
+                    Clear();
+                    return false;
+                }
+
+                m_composites.push_back(CSGCompositeInstance(placeableComposites[placed], position, orientation));
+                shapeUnion.shapeType = CSGShapes::Composite;
+                shapeUnion.composite = m_composites.size() - 1;
+                break;
+            }
+            case CSGShapes::Prism:
+            {
+                if (primitive.firstPoint < 0 || primitive.numPoints < 0
+                    || static_cast<size_t>(primitive.firstPoint) + static_cast<size_t>(primitive.numPoints) > desc.numPoints)
+                {
+                    dbLogf("Primitive %d uses points outside of the %d given.", nextPrimitive - 1, desc.numPoints);
+                    Clear();
+                    return false;
+                }
+
+                m_prisms.push_back(CSGPrism(desc.points + (primitive.firstPoint * 2), static_cast<size_t>(primitive.numPoints),
+                    primitive.dimensions[1], position, orientation, m_prisms.get_allocator().GetResource()));
+                shapeUnion.shapeType = CSGShapes::Prism;
+                shapeUnion.prism = m_prisms.size() - 1;
+                break;
+            }
+            default:
+                dbLogf("Primitive type %d can't be built from a description.", primitive.shapeType);
+                Clear();
+                return false;
+            }
+
+            operandStack.push_back(AddShapeNode(shapeUnion));
+            break;
+        }
+        case ShapeOperations::Union:
+        case ShapeOperations::Difference:
+        case ShapeOperations::Intersection:
+        {
+            if (operandStack.size() < 2)
+            {
+                dbLogf("Operation %d is missing an operand.", i);
+                Clear();
+                return false;
+            }
+
+            size_t right = operandStack.back();
+            operandStack.pop_back();
+            size_t left = operandStack.back();
+            operandStack.pop_back();
+            operandStack.push_back(AddOperationNode(operation, left, right));
+            break;
+        }
+        default:
+            dbLogf("Invalid shape operation %d", operation);
+            Clear();
+            return false;
+        }
+    }
+
+    if (operandStack.size() != 1 || nextPrimitive != numPrimitives)
+    {
+        dbLogf("The operations leave %d trees and %d unused primitives.", operandStack.size(), numPrimitives - nextPrimitive);
+        Clear();
+        return false;
+    }
+
+    m_root = operandStack.back();
+    return true;
+}
+
+void CompositeShape::ReorderOperands(const Vector4* samplePoints, size_t numSamplePoints)
+{
+    if (m_root == s_InvalidIndex || numSamplePoints == 0)
+    {
+        return;
+    }
+
+    std::vector<size_t> postorder;
+    postorder.reserve(m_nodes.size());
+    CollectPostorder(m_root, postorder);
+
+    std::vector<size_t> trueCounts(m_nodes.size(), 0);
+    std::vector<char> results(m_nodes.size(), 0);
+    for (size_t i = 0; i < numSamplePoints; ++i)
+    {
+        ProfileNodes(postorder, samplePoints[i], results, trueCounts);
+    }
+
+    std::vector<double> nodeCosts(m_nodes.size(), 0.0);
+    CalcNodeCost(m_root, nodeCosts);
+
+    ResourceVector<CompositeNode> reordered(m_nodes.get_allocator());
+    reordered.reserve(m_nodes.size());
+    m_root = EmitReorderedNode(m_root, trueCounts, nodeCosts, numSamplePoints, reordered);
+    m_nodes.swap(reordered);
+}
+
+CompositeShape CompositeShape::CreateSimplified(double minDifferenceSize) const
+{
+    return CreateSimplified(minDifferenceSize, m_nodes.get_allocator().GetResource());
+}
+
+CompositeShape CompositeShape::CreateSimplified(double minDifferenceSize, MemoryResource* resource) const
+{
+    CompositeShape simplified(resource);
+    simplified.m_position = m_position;
+
+    if (m_root != s_InvalidIndex)
+    {
+        // Simplifying only ever removes things, so the source's sizes are an upper bound.
+        simplified.m_shapes.reserve(m_shapes.size());
+        simplified.m_nodes.reserve(m_nodes.size());
+        simplified.m_modules.reserve(m_modules.size());
+        simplified.m_composites.reserve(m_composites.size());
+        simplified.m_prisms.reserve(m_prisms.size());
+
+        std::vector<BoundingBox> nodeBounds(m_nodes.size());
+        FillNodeBounds(m_root, nodeBounds);
+        simplified.m_root = simplified.CopySimplifiedNode(*this, m_root, nodeBounds, minDifferenceSize);
+    }
+
+    return simplified;
+}
+
+void CompositeShape::CalcMemoryUsage(CompositeMemoryUsage& inOutUsage) const
+{
+    inOutUsage.primitives += m_shapes.capacity() * sizeof(ShapeUnion);
+    inOutUsage.primitives += m_modules.capacity() * sizeof(CSGModuleInstance);
+    inOutUsage.primitives += m_composites.capacity() * sizeof(CSGCompositeInstance);
+    inOutUsage.primitives += m_prisms.capacity() * sizeof(CSGPrism);
+    for (const CSGPrism& prism : m_prisms)
+    {
+        inOutUsage.primitives += prism.CalcMemoryUsage();
+    }
+    inOutUsage.nodes += m_nodes.capacity() * sizeof(CompositeNode);
+}
+
+void CompositeShape::Combine(ShapeOperations operation, const ShapeUnion& shape)
+{
+    if (LeavesNothing(operation))
+    {
+        return;
+    }
+
+    size_t shapeNode = AddShapeNode(shape);
+
+    m_root = (m_root == s_InvalidIndex) ? shapeNode : AddOperationNode(operation, m_root, shapeNode);
+    ++m_version;
+}
+
+void CompositeShape::Combine(ShapeOperations operation, const CSGModuleInstance& module)
+{
+    if (LeavesNothing(operation))
+    {
+        return;
+    }
+
+    m_modules.push_back(module);
+
+    ShapeUnion shapeUnion;
+    shapeUnion.shapeType = CSGShapes::Module;
+    shapeUnion.module = m_modules.size() - 1;
+    Combine(operation, shapeUnion);
+}
+
+void CompositeShape::Combine(ShapeOperations operation, const CSGCompositeInstance& composite)
+{
+    if (LeavesNothing(operation))
+    {
+        return;
+    }
+    if (&composite.GetComposite() == this)
+    {
+        dbLogf("A composite can't be placed inside itself.");
+        return;
+    }
+
+    m_composites.push_back(composite);
+
+    ShapeUnion shapeUnion;
+    shapeUnion.shapeType = CSGShapes::Composite;
+    shapeUnion.composite = m_composites.size() - 1;
+    Combine(operation, shapeUnion);
+}
+
+void CompositeShape::Combine(ShapeOperations operation, const CSGPrism& prism)
+{
+    if (LeavesNothing(operation))
+    {
+        return;
+    }
+
+    m_prisms.push_back(CSGPrism(prism, m_prisms.get_allocator().GetResource()));
+
+    ShapeUnion shapeUnion;
+    shapeUnion.shapeType = CSGShapes::Prism;
+    shapeUnion.prism = m_prisms.size() - 1;
+    Combine(operation, shapeUnion);
+}
+
+size_t CompositeShape::AddShapeNode(const ShapeUnion& shape)
+{
+    m_shapes.push_back(shape);
+
+    CompositeNode node;
+    node.operation = ShapeOperations::Shape;
+    node.shape = m_shapes.size() - 1;
+    m_nodes.push_back(node);
+
+    return m_nodes.size() - 1;
+}
+
+void CompositeShape::Clear()
+{
+    m_shapes.clear();
+    m_nodes.clear();
+    m_modules.clear();
+    m_composites.clear();
+    m_prisms.clear();
+    m_root = s_InvalidIndex;
+    ++m_version;
+}
+
+size_t CompositeShape::CopyShapeNode(const CompositeShape& source, size_t sourceShape)
+{
+    const ShapeUnion& shape = source.m_shapes[sourceShape];
+
+    // Module, composite and prism indices refer to the source's storage, so bring the primitive along.
+    switch (shape.shapeType)
+    {
+    case CSGShapes::Module:
+    {
+        m_modules.push_back(source.m_modules[shape.module]);
+
+        ShapeUnion shapeUnion;
+        shapeUnion.shapeType = CSGShapes::Module;
+        shapeUnion.module = m_modules.size() - 1;
+        return AddShapeNode(shapeUnion);
+    }
+    case CSGShapes::Composite:
+    {
+        m_composites.push_back(source.m_composites[shape.composite]);
+
+        ShapeUnion shapeUnion;
+        shapeUnion.shapeType = CSGShapes::Composite;
+        shapeUnion.composite = m_composites.size() - 1;
+        return AddShapeNode(shapeUnion);
+    }
+    case CSGShapes::Prism:
+    {
+        m_prisms.push_back(CSGPrism(source.m_prisms[shape.prism], m_prisms.get_allocator().GetResource()));
+
+        ShapeUnion shapeUnion;
+        shapeUnion.shapeType = CSGShapes::Prism;
+        shapeUnion.prism = m_prisms.size() - 1;
+        return AddShapeNode(shapeUnion);
+    }
+    default:
+        return AddShapeNode(shape);
+    }
+}
+
+size_t CompositeShape::AddOperationNode(ShapeOperations operation, size_t left, size_t right)
+{
+    CompositeNode node;
+    node.operation = operation;
+    node.left = left;
+    node.right = right;
+    m_nodes.push_back(node);
+
+    return m_nodes.size() - 1;
+}
+
+BoundingBox CompositeShape::CalcShapeBounds(size_t shapeIndex) const
+{
+    const ShapeUnion& shape = m_shapes[shapeIndex];
+
+    switch (shape.shapeType)
+    {
+    case CSGShapes::Cuboid:
+        return shape.cuboid.CalcBounds();
+    case CSGShapes::Module:
+        return m_modules[shape.module].GetBounds();
+    case CSGShapes::Composite:
+        return m_composites[shape.composite].GetBounds();
+    case CSGShapes::Prism:
+        return m_prisms[shape.prism].CalcBounds();
+    default:
+        dbLogf("Invalid shape type %d", shape.shapeType);
+        return BoundingBox();
+    }
+}
+
+void CompositeShape::FillNodeBounds(size_t nodeIndex, std::vector<BoundingBox>& outNodeBounds) const
+{
+    std::vector<size_t> postorder;
+    CollectPostorder(nodeIndex, postorder);
+
+    // Every operand comes before its operation, so its bounds are always ready.
+    for (size_t index : postorder)
+    {
+        const CompositeNode& node = m_nodes[index];
+
+        switch (node.operation)
+        {
+        case ShapeOperations::Shape:
+            outNodeBounds[index] = CalcShapeBounds(node.shape);
+            break;
+
+        case ShapeOperations::Union:
+        {
+            BoundingBox bounds = outNodeBounds[node.left];
+            bounds.Encapsulate(outNodeBounds[node.right]);
+            outNodeBounds[index] = bounds;
+            break;
+        }
+        case ShapeOperations::Difference:
+            outNodeBounds[index] = outNodeBounds[node.left]; // Subtracting can only shrink the left operand, so its bounds are conservative.
+            break;
+
+        case ShapeOperations::Intersection:
+            outNodeBounds[index] = outNodeBounds[node.left].CalcIntersection(outNodeBounds[node.right]);
+            break;
+
+        default:
+            dbLogf("Invalid shape operation %d", node.operation);
+            break;
+        }
+    }
+}
+
+void CompositeShape::CollectPostorder(size_t nodeIndex, std::vector<size_t>& outPostorder) const
+{
+    // Composites can be long chains, so walk them with an explicit stack rather than recursing once per node.
+    std::vector<std::pair<size_t, bool>> pending; // Nodes, and whether their operands have been pushed yet.
+    pending.push_back(std::make_pair(nodeIndex, false));
+
+    while (!pending.empty())
+    {
+        std::pair<size_t, bool> entry = pending.back();
+        pending.pop_back();
+
+        const CompositeNode& node = m_nodes[entry.first];
+        if (entry.second || node.operation == ShapeOperations::Shape)
+        {
+            outPostorder.push_back(entry.first);
+            continue;
+        }
+
+        pending.push_back(std::make_pair(entry.first, true));
+        pending.push_back(std::make_pair(node.right, false));
+        pending.push_back(std::make_pair(node.left, false)); // Pushed last so the left operand comes out first.
+    }
+}
+
+bool CompositeShape::NodeOverlaps(size_t nodeIndex, const std::vector<BoundingBox>& nodeBounds,
+    const CompositeShape& other, size_t otherNode, const std::vector<BoundingBox>& otherNodeBounds) const
+{
+    // Like NodeContains(), each operation waits on a stack while its left operand is tested, so long chains don't recurse.
+    struct NodePair
+    {
+        const CompositeShape* composite; // The side whose operations are being broken down.
+        size_t node;
+        const std::vector<BoundingBox>* nodeBounds;
+        const CompositeShape* other;
+        size_t otherNode;
+        const std::vector<BoundingBox>* otherNodeBounds;
+    };
+
+    struct Frame
+    {
+        NodePair pair;
+        bool testingRight;
+    };
+
+    std::vector<Frame> pending;
+    NodePair current = { this, nodeIndex, &nodeBounds, &other, otherNode, &otherNodeBounds };
+    for (;;)
+    {
+        bool result = false;
+        for (;;)
+        {
+            if (!(*current.nodeBounds)[current.node].Overlaps((*current.otherNodeBounds)[current.otherNode]))
+            {
+                break;
+            }
+
+            const CompositeNode& node = current.composite->m_nodes[current.node];
+            if (node.operation == ShapeOperations::Shape)
+            {
+                if (current.other->m_nodes[current.otherNode].operation == ShapeOperations::Shape)
+                {
+                    result = current.composite->LeafOverlaps(current.node, *current.other, current.otherNode);
+                    break;
+                }
+                // Swap sides so the other composite's operations get broken down until both sides are leaves.
+                NodePair swapped = { current.other, current.otherNode, current.otherNodeBounds, current.composite, current.node, current.nodeBounds };
+                current = swapped;
+                continue;
+            }
+            if (node.operation != ShapeOperations::Union && node.operation != ShapeOperations::Intersection
+                && node.operation != ShapeOperations::Difference)
+            {
+                dbLogf("Invalid shape operation %d", node.operation);
+                break;
+            }
+
+            Frame frame = { current, false };
+            pending.push_back(frame);
+            current.node = node.left;
+        }
+
+        // Climb back up until an operation still needs its right operand.
+        bool needsRight = false;
+        while (!pending.empty())
+        {
+            Frame& frame = pending.back();
+            const CompositeShape& composite = *frame.pair.composite;
+            const CompositeNode& node = composite.m_nodes[frame.pair.node];
+
+            if (frame.testingRight || (node.operation == ShapeOperations::Union) == result)
+            {
+                pending.pop_back(); // Either the right operand's result, or settled by the left one, is the whole operation's.
+            }
+            else if (node.operation == ShapeOperations::Difference)
+            {
+                // The overlap is only cut away if the right operand covers all of the region where it could be.
+                BoundingBox overlapRegion = (*frame.pair.nodeBounds)[node.left].CalcIntersection((*frame.pair.otherNodeBounds)[frame.pair.otherNode]);
+                result = !composite.NodeContainsBox(node.right, overlapRegion, *frame.pair.nodeBounds);
+                pending.pop_back();
+            }
+            else
+            {
+                // For an intersection, both operands overlapping is necessary but not sufficient, which is the conservative side to be wrong on.
+                frame.testingRight = true;
+                current = frame.pair;
+                current.node = node.right;
+                needsRight = true;
+                break;
+            }
+        }
+
+        if (!needsRight)
+        {
+            return result;
+        }
+    }
+}
+
+bool CompositeShape::LeafOverlaps(size_t nodeIndex, const CompositeShape& other, size_t otherNode) const
+{
+    const ShapeUnion& shape = m_shapes[m_nodes[nodeIndex].shape];
+    const ShapeUnion& otherShape = other.m_shapes[other.m_nodes[otherNode].shape];
+
+    // Placed composites are tested exactly, through their placement. Any further nesting is handled on the way back in.
+    if (shape.shapeType == CSGShapes::Composite)
+    {
+        return PlacementOverlaps(m_composites[shape.composite], other, otherNode);
+    }
+    if (otherShape.shapeType == CSGShapes::Composite)
+    {
+        return other.PlacementOverlaps(other.m_composites[otherShape.composite], *this, nodeIndex);
+    }
+
+    // Prisms are tested exactly against each other, and against the cuboid standing in for anything else.
+    if (shape.shapeType == CSGShapes::Prism && otherShape.shapeType == CSGShapes::Prism)
+    {
+        return m_prisms[shape.prism].Overlaps(other.m_prisms[otherShape.prism]);
+    }
+    if (shape.shapeType == CSGShapes::Prism)
+    {
+        CSGCuboid otherCuboid;
+        other.CalcLeafCuboid(otherNode, otherCuboid);
+        return m_prisms[shape.prism].Overlaps(otherCuboid);
+    }
+    if (otherShape.shapeType == CSGShapes::Prism)
+    {
+        CSGCuboid cuboid;
+        CalcLeafCuboid(nodeIndex, cuboid);
+        return other.m_prisms[otherShape.prism].Overlaps(cuboid);
+    }
+
+    CSGCuboid cuboid;
+    CalcLeafCuboid(nodeIndex, cuboid);
+
+    CSGCuboid otherCuboid;
+    other.CalcLeafCuboid(otherNode, otherCuboid);
+
+    return cuboid.Overlaps(otherCuboid);
+}
+
+bool CompositeShape::PlacementOverlaps(const CSGCompositeInstance& placement, const CompositeShape& other, size_t otherNode) const
+{
+    // Moving the single leaf into the placement's space is much cheaper than moving everything placed there out of it.
+    CompositeShape moved(m_nodes.get_allocator().GetResource());
+    moved.m_root = moved.CopyShapeNode(other, other.m_nodes[otherNode].shape);
+    moved.Transform(placement.GetOuterToInstanceMatrix());
+
+    return placement.GetComposite().Overlaps(moved);
+}
+
+void CompositeShape::Transform(const Matrix4x4& transform)
 {
-    if (m_nodes.empty())
+    // The tree keeps its shape, so only the primitives need moving.
+    for (ShapeUnion& shape : m_shapes)
     {
-        return false;
+        if (shape.shapeType == CSGShapes::Cuboid)
+        {
+            shape.cuboid.Transform(transform);
+        }
+    }
+    for (CSGModuleInstance& module : m_modules)
+    {
+        module.Transform(transform);
+    }
+    for (CSGCompositeInstance& composite : m_composites)
+    {
+        composite.Transform(transform);
+    }
+    for (CSGPrism& prism : m_prisms)
+    {
+        prism.Transform(transform);
+    }
+}
+
+bool CompositeShape::NodeContainsBox(size_t nodeIndex, const BoundingBox& box, const std::vector<BoundingBox>& nodeBounds) const
+{
+    // Walked like NodeContains(), with the operations waiting on their left operand kept on a stack.
+    std::vector<std::pair<size_t, bool>> pending; // Operations, and whether their right operand is being tested.
+    for (;;)
+    {
+        const CompositeNode* node = &m_nodes[nodeIndex];
+        while (node->operation == ShapeOperations::Union || node->operation == ShapeOperations::Difference
+            || node->operation == ShapeOperations::Intersection)
+        {
+            pending.push_back(std::make_pair(nodeIndex, false));
+            nodeIndex = node->left;
+            node = &m_nodes[nodeIndex];
+        }
+
+        bool result = false;
+        if (node->operation == ShapeOperations::Shape)
+        {
+            const ShapeUnion& shape = m_shapes[node->shape];
+            // Only cuboids are exactly their bounds; anything else can't prove containment this way.
+            result = shape.shapeType == CSGShapes::Cuboid && shape.cuboid.Contains(box);
+        }
+        else
+        {
+            dbLogf("Invalid shape operation %d", node->operation);
+        }
+
+        // A union misses boxes that are only covered by both operands together, which keeps this conservative.
+        bool needsRight = false;
+        while (!pending.empty())
+        {
+            std::pair<size_t, bool>& entry = pending.back();
+            const CompositeNode& operation = m_nodes[entry.first];
+
+            if (entry.second || (operation.operation == ShapeOperations::Union) == result)
+            {
+                pending.pop_back();
+            }
+            else if (operation.operation == ShapeOperations::Difference)
+            {
+                result = !nodeBounds[operation.right].Overlaps(box);
+                pending.pop_back();
+            }
+            else
+            {
+                entry.second = true;
+                nodeIndex = operation.right;
+                needsRight = true;
+                break;
+            }
+        }
+
+        if (!needsRight)
+        {
+            return result;
+        }
+    }
+}
+
+void CompositeShape::CalcLeafCuboid(size_t nodeIndex, CSGCuboid& outCuboid) const
+{
+    const ShapeUnion& shape = m_shapes[m_nodes[nodeIndex].shape];
+
+    switch (shape.shapeType)
+    {
+    case CSGShapes::Cuboid:
+        outCuboid = shape.cuboid;
+        break;
+    case CSGShapes::Module:
+    {
+        const BoundingBox& bounds = m_modules[shape.module].GetBounds();
+        outCuboid = CSGCuboid(bounds.minCorner, bounds.CalcSize(), Quaternion());
+        break;
     }
+    case CSGShapes::Composite:
+    {
+        const BoundingBox& bounds = m_composites[shape.composite].GetBounds();
+        outCuboid = CSGCuboid(bounds.minCorner, bounds.CalcSize(), Quaternion());
+        break;
+    }
+    case CSGShapes::Prism:
+    {
+        BoundingBox bounds = m_prisms[shape.prism].CalcBounds();
+        outCuboid = CSGCuboid(bounds.minCorner, bounds.CalcSize(), Quaternion());
+        break;
+    }
+    default:
+        dbLogf("Invalid shape type %d", shape.shapeType);
+        break;
+    }
+}
+
+size_t CompositeShape::CopySimplifiedNode(const CompositeShape& source, size_t sourceNode, const std::vector<BoundingBox>& sourceNodeBounds,
+    double minDifferenceSize)
+{
+    // Copying a source node either emits it straight away or schedules its operands followed by the operation that joins them.
+    // Operands always finish before their operation, so the copy stays in postorder, and long chains need no recursion.
+    struct Task
+    {
+        size_t sourceNode; // The node to copy, or s_InvalidIndex to join the last two results with the operation.
+        ShapeOperations operation;
+    };
 
-    // Turn the composition tree into an input vector that can be evaluated as RPN.
-    std::stack<const CompositeNode*> nodeStack;
-    nodeStack.push(&m_nodes.front());
+    std::vector<Task> tasks;
+    std::vector<size_t> results;
 
-    std::vector<const CompositeNode*> rpnInput;
+    Task root = { sourceNode, ShapeOperations::Invalid };
+    tasks.push_back(root);
 
-    while (!nodeStack.empty())
+    while (!tasks.empty())
     {
-        const CompositeNode& node = *(nodeStack.top());
-        nodeStack.pop();
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        if (task.sourceNode == s_InvalidIndex)
+        {
+            size_t right = results.back();
+            results.pop_back();
+            size_t left = results.back();
+            results.pop_back();
+            results.push_back(AddOperationNode(task.operation, left, right));
+            continue;
+        }
 
-        rpnInput.push_back(&node);
+        const CompositeNode& node = source.m_nodes[task.sourceNode];
 
         switch (node.operation)
         {
         case ShapeOperations::Shape:
+            results.push_back(CopyShapeNode(source, node.shape));
             break;
 
-        case ShapeOperations::Union:
         case ShapeOperations::Difference:
         case ShapeOperations::Intersection:
         {
-            nodeStack.push(node.left);
-            nodeStack.push(node.right);
+            // Small cutouts such as windows disappear at a distance anyway, so skip straight to what they were cut from.
+            Task left = { node.left, ShapeOperations::Invalid };
+            if (node.operation == ShapeOperations::Difference && sourceNodeBounds[node.right].CalcMaxExtent() < minDifferenceSize)
+            {
+                tasks.push_back(left);
+                break;
+            }
+
+            Task join = { s_InvalidIndex, node.operation };
+            Task right = { node.right, ShapeOperations::Invalid };
+            tasks.push_back(join);
+            tasks.push_back(right);
+            tasks.push_back(left);
+            break;
+        }
+        case ShapeOperations::Union:
+        {
+            // Flatten the run of unions so that every cuboid or prism in it gets a chance to merge with every other one.
+            std::vector<size_t> operands;
+            source.GatherOperands(task.sourceNode, ShapeOperations::Union, operands);
+
+            std::vector<CSGCuboid> cuboids;
+            std::vector<std::vector<const CSGPrism*>> prismGroups; // Each group can merge with its first prism.
+            std::vector<size_t> otherOperands;
+            for (size_t operand : operands)
+            {
+                const CompositeNode& operandNode = source.m_nodes[operand];
+                const CSGShapes shapeType = (operandNode.operation == ShapeOperations::Shape)
+                    ? source.m_shapes[operandNode.shape].shapeType : CSGShapes::Invalid;
+                if (shapeType == CSGShapes::Cuboid)
+                {
+                    cuboids.push_back(source.m_shapes[operandNode.shape].cuboid);
+                }
+                else if (shapeType == CSGShapes::Prism)
+                {
+                    // Walls and floors of one level share their frame, so they mostly end up as one prism of each height.
+                    const CSGPrism& prism = source.m_prisms[source.m_shapes[operandNode.shape].prism];
+                    auto group = std::find_if(prismGroups.begin(), prismGroups.end(),
+                        [&prism](const std::vector<const CSGPrism*>& candidate) { return candidate[0]->CanMerge(prism); });
+                    if (group != prismGroups.end())
+                    {
+                        group->push_back(&prism);
+                    }
+                    else
+                    {
+                        prismGroups.push_back(std::vector<const CSGPrism*>(1, &prism));
+                    }
+                }
+                else
+                {
+                    otherOperands.push_back(operand);
+                }
+            }
+
+            // Keep merging until no pair can be merged, since each merge may line a cuboid up with another.
+            bool mergedAny = true;
+            while (mergedAny)
+            {
+                mergedAny = false;
+                for (size_t i = 0; i < cuboids.size(); ++i)
+                {
+                    for (size_t j = i + 1; j < cuboids.size();)
+                    {
+                        CSGCuboid merged;
+                        if (cuboids[i].TryMerge(cuboids[j], merged))
+                        {
+                            cuboids[i] = merged;
+                            cuboids.erase(cuboids.begin() + j);
+                            mergedAny = true;
+                        }
+                        else
+                        {
+                            ++j;
+                        }
+                    }
+                }
+            }
+
+            size_t merged = s_InvalidIndex;
+            for (const CSGCuboid& cuboid : cuboids)
+            {
+                ShapeUnion shapeUnion;
+                shapeUnion.shapeType = CSGShapes::Cuboid;
+                shapeUnion.cuboid = cuboid;
+                size_t shapeNode = AddShapeNode(shapeUnion);
+
+                merged = (merged == s_InvalidIndex) ? shapeNode : AddOperationNode(ShapeOperations::Union, merged, shapeNode);
+            }
+            for (const std::vector<const CSGPrism*>& group : prismGroups)
+            {
+                m_prisms.push_back(CSGPrism(group.data(), group.size(), m_prisms.get_allocator().GetResource()));
+
+                ShapeUnion shapeUnion;
+                shapeUnion.shapeType = CSGShapes::Prism;
+                shapeUnion.prism = m_prisms.size() - 1;
+                size_t shapeNode = AddShapeNode(shapeUnion);
+
+                merged = (merged == s_InvalidIndex) ? shapeNode : AddOperationNode(ShapeOperations::Union, merged, shapeNode);
+            }
+            if (merged != s_InvalidIndex)
+            {
+                results.push_back(merged);
+            }
+
+            // Union each of the other operands onto the chain in turn. The tasks are pushed in reverse, so they come out in order.
+            for (size_t i = otherOperands.size(); i-- > 0;)
+            {
+                if (i > 0 || merged != s_InvalidIndex)
+                {
+                    Task join = { s_InvalidIndex, ShapeOperations::Union };
+                    tasks.push_back(join);
+                }
+                Task operand = { otherOperands[i], ShapeOperations::Invalid };
+                tasks.push_back(operand);
+            }
             break;
         }
         default:
             dbLogf("Invalid shape operation %d", node.operation);
-            return false;
+            results.push_back(static_cast<size_t>(s_InvalidIndex)); // A copy, since push_back() takes a reference.
+            break;
+        }
+    }
+
+    return results.back();
+}
+
+void CompositeShape::GatherOperands(size_t nodeIndex, ShapeOperations operation, std::vector<size_t>& outOperands) const
+{
+    std::vector<size_t> pending;
+    pending.push_back(nodeIndex);
+
+    while (!pending.empty())
+    {
+        size_t index = pending.back();
+        pending.pop_back();
+
+        const CompositeNode& node = m_nodes[index];
+        if (node.operation != operation)
+        {
+            outOperands.push_back(index);
+            continue;
+        }
+        pending.push_back(node.right);
+        pending.push_back(node.left); // Pushed last so the operands come out left to right.
+    }
+}
+
+bool CompositeShape::NodeContains(size_t nodeIndex, const Vector4& point) const
+{
+    // Composites without placements keep to this tighter walk. Being able to switch composites mid-walk makes it about a fifth
+    // slower.
+    if (!m_composites.empty())
+    {
+        return WalkContainsThroughPlacements(nodeIndex, point);
+    }
+
+    // Each operation waits on the stack while its left operand is evaluated. The left operand is always evaluated first, so the
+    // right one is skipped whenever the left one settles the result.
+    struct Frame
+    {
+        size_t node;
+        bool evaluatingRight;
+    };
+
+    InlineStack<Frame, s_ContainsStackSize> pending;
+    for (;;)
+    {
+        const CompositeNode* node = &m_nodes[nodeIndex];
+        while (node->operation == ShapeOperations::Union || node->operation == ShapeOperations::Difference
+            || node->operation == ShapeOperations::Intersection)
+        {
+            Frame frame = { nodeIndex, false };
+            pending.Push(frame);
+            nodeIndex = node->left;
+            node = &m_nodes[nodeIndex];
+        }
+
+        bool result = false;
+        if (node->operation == ShapeOperations::Shape)
+        {
+            result = ShapeContains(node->shape, point);
+        }
+        else
+        {
+            dbLogf("Invalid shape operation %d", node->operation);
+        }
+
+        // Climb back up until an operation still needs its right operand.
+        bool needsRight = false;
+        while (!pending.IsEmpty())
+        {
+            Frame& frame = pending.Top();
+            const CompositeNode& operation = m_nodes[frame.node];
+
+            if (frame.evaluatingRight)
+            {
+                result = (operation.operation == ShapeOperations::Difference) ? !result : result;
+                pending.Pop();
+            }
+            else if ((operation.operation == ShapeOperations::Union) == result)
+            {
+                pending.Pop(); // Settled by the left operand, which has the same result as the whole operation.
+            }
+            else if (m_nodes[operation.right].operation == ShapeOperations::Shape)
+            {
+                // Most right operands are single shapes, which can be tested without another trip down.
+                bool rightResult = ShapeContains(m_nodes[operation.right].shape, point);
+                result = (operation.operation == ShapeOperations::Difference) ? !rightResult : rightResult;
+                pending.Pop();
+            }
+            else
+            {
+                frame.evaluatingRight = true;
+                nodeIndex = operation.right;
+                needsRight = true;
+                break;
+            }
+        }
+
+        if (!needsRight)
+        {
+            return result;
+        }
+    }
+}
+
+bool CompositeShape::WalkContainsThroughPlacements(size_t nodeIndex, const Vector4& point) const
+{
+    // Each operation waits on the stack while its left operand is evaluated. The left operand is always evaluated first, so the
+    // right one is skipped whenever the left one settles the result.
+    //
+    // Placed composites are walked on the same stack rather than through another call. Entering one pushes a placement frame
+    // remembering the outer composite and point, and the point continues down in the placed composite's space through the
+    // placement's cached inverse transform. The frame restores both once the placed composite has its result.
+    enum class Step
+    {
+        Left,
+        Right,
+        Placement,
+    };
+
+    struct Frame
+    {
+        size_t node; // In the composite being walked when the frame was pushed. Unused by placement frames.
+        Step step;
+    };
+
+    struct PlacedSpace
+    {
+        const CompositeShape* outerComposite;
+        Vector4 point; // In the placed composite's space.
+    };
+
+    InlineStack<Frame, s_ContainsStackSize> pending;
+    std::vector<PlacedSpace> placedSpaces;
+    const CompositeShape* composite = this;
+    const CompositeNode* nodes = m_nodes.data(); // Cached, since the compiler can't tell that the walk never changes them.
+    const ShapeUnion* shapes = m_shapes.data();
+    const Vector4* localPoint = &point;
+    for (;;)
+    {
+        const CompositeNode* node = &nodes[nodeIndex];
+        while (node->operation == ShapeOperations::Union || node->operation == ShapeOperations::Difference
+            || node->operation == ShapeOperations::Intersection)
+        {
+            Frame frame = { nodeIndex, Step::Left };
+            pending.Push(frame);
+            nodeIndex = node->left;
+            node = &nodes[nodeIndex];
+        }
+
+        bool result = false;
+        if (node->operation != ShapeOperations::Shape)
+        {
+            dbLogf("Invalid shape operation %d", node->operation);
+        }
+        else if (shapes[node->shape].shapeType != CSGShapes::Composite)
+        {
+            result = composite->ShapeContains(node->shape, *localPoint);
+        }
+        else
+        {
+            // Points outside the placement's cached bounds are rejected without entering it at all.
+            const CSGCompositeInstance& placement = composite->m_composites[shapes[node->shape].composite];
+            const CompositeShape& placed = placement.GetComposite();
+            if (placement.GetBounds().Contains(*localPoint) && placed.m_root != s_InvalidIndex)
+            {
+                PlacedSpace placedSpace = { composite, placement.GetOuterToInstanceMatrix().TransformPoint(*localPoint) };
+                placedSpaces.push_back(placedSpace);
+                Frame frame = { s_InvalidIndex, Step::Placement };
+                pending.Push(frame);
+
+                localPoint = &placedSpaces.back().point;
+                composite = &placed;
+                nodes = placed.m_nodes.data();
+                shapes = placed.m_shapes.data();
+                nodeIndex = placed.m_root;
+                continue;
+            }
+        }
+
+        // Climb back up until an operation still needs its right operand.
+        bool needsRight = false;
+        while (!pending.IsEmpty())
+        {
+            Frame& frame = pending.Top();
+            if (frame.step == Step::Placement)
+            {
+                composite = placedSpaces.back().outerComposite;
+                nodes = composite->m_nodes.data();
+                shapes = composite->m_shapes.data();
+                placedSpaces.pop_back();
+                localPoint = placedSpaces.empty() ? &point : &placedSpaces.back().point;
+                pending.Pop(); // The placement's result is the leaf's result in the outer composite.
+                continue;
+            }
+
+            const CompositeNode& operation = nodes[frame.node];
+            if (frame.step == Step::Right)
+            {
+                result = (operation.operation == ShapeOperations::Difference) ? !result : result;
+                pending.Pop();
+            }
+            else if ((operation.operation == ShapeOperations::Union) == result)
+            {
+                pending.Pop(); // Settled by the left operand, which has the same result as the whole operation.
+            }
+            else if (nodes[operation.right].operation == ShapeOperations::Shape
+                && (shapes[nodes[operation.right].shape].shapeType != CSGShapes::Composite))
+            {
+                // Most right operands are single shapes, which can be tested without another trip down.
+                bool rightResult = composite->ShapeContains(nodes[operation.right].shape, *localPoint);
+                result = (operation.operation == ShapeOperations::Difference) ? !rightResult : rightResult;
+                pending.Pop();
+            }
+            else
+            {
+                frame.step = Step::Right;
+                nodeIndex = operation.right;
+                needsRight = true;
+                break;
+            }
+        }
+
+        if (!needsRight)
+        {
+            return result;
         }
     }
+}
+
+bool CompositeShape::ShapeContains(size_t shapeIndex, const Vector4& point) const
+{
+    const ShapeUnion& shape = m_shapes[shapeIndex];
 
-    // Evaluate the RPN input backwards, as it was built backwards.
-    std::stack<bool> evalStack;
+    switch (shape.shapeType)
+    {
+    case CSGShapes::Cuboid:
+        return shape.cuboid.Contains(point);
+    case CSGShapes::Module:
+        return m_modules[shape.module].Contains(point);
+    case CSGShapes::Composite:
+        return m_composites[shape.composite].Contains(point);
+    case CSGShapes::Prism:
+        return m_prisms[shape.prism].Contains(point);
+    default:
+        dbLogf("Invalid shape type %d", shape.shapeType);
+        return false;
+    }
+}
 
-    for (auto i = rpnInput.rbegin(), end = rpnInput.rend(); i < end; ++i)
+void CompositeShape::ProfileNodes(const std::vector<size_t>& postorder, const Vector4& point, std::vector<char>& scratchResults,
+    std::vector<size_t>& inOutTrueCounts) const
+{
+    // Unlike NodeContains(), both operands are always evaluated, so every node's odds are measured independently of the current order.
+    for (size_t nodeIndex : postorder)
     {
-        const CompositeNode& node = **i;
+        const CompositeNode& node = m_nodes[nodeIndex];
 
+        bool result = false;
         switch (node.operation)
         {
         case ShapeOperations::Shape:
+            result = ShapeContains(node.shape, point);
+            break;
+        case ShapeOperations::Union:
+            result = scratchResults[node.left] || scratchResults[node.right];
+            break;
+        case ShapeOperations::Difference:
+            result = scratchResults[node.left] && !scratchResults[node.right];
+            break;
+        case ShapeOperations::Intersection:
+            result = scratchResults[node.left] && scratchResults[node.right];
+            break;
+        default:
+            dbLogf("Invalid shape operation %d", node.operation);
+            break;
+        }
+
+        scratchResults[nodeIndex] = result ? 1 : 0;
+        if (result)
         {
-            const ShapeUnion& shape = m_shapes[node.shape];
+            ++inOutTrueCounts[nodeIndex];
+        }
+    }
+}
+
+double CompositeShape::CalcNodeCost(size_t nodeIndex, std::vector<double>& outNodeCosts) const
+{
+    std::vector<size_t> postorder;
+    CollectPostorder(nodeIndex, postorder);
 
+    for (size_t index : postorder)
+    {
+        const CompositeNode& node = m_nodes[index];
+
+        double cost = 0.0;
+        if (node.operation == ShapeOperations::Shape)
+        {
+            // Rough relative costs of a single containment test.
+            const ShapeUnion& shape = m_shapes[node.shape];
             switch (shape.shapeType)
             {
             case CSGShapes::Cuboid:
+                cost = 1.0;
+                break;
+            case CSGShapes::Module:
+                cost = 2.0; // A virtual call plus a handful of inlined boxes.
+                break;
+            case CSGShapes::Prism:
+                cost = 1.0 + (m_prisms[shape.prism].NumEdges() * 0.25);
+                break;
+            case CSGShapes::Composite:
             {
-                evalStack.push(shape.cuboid.Contains(point));
+                const CompositeShape& placed = m_composites[shape.composite].GetComposite();
+                if (placed.m_root != s_InvalidIndex)
+                {
+                    std::vector<double> placedCosts(placed.m_nodes.size());
+                    cost = 1.0 + placed.CalcNodeCost(placed.m_root, placedCosts);
+                }
                 break;
             }
             default:
                 dbLogf("Invalid shape type %d", shape.shapeType);
-                return false;
+                break;
             }
-
-            break;
         }
-        case ShapeOperations::Union:
+        else
         {
-            bool lhs = evalStack.top();
-            evalStack.pop();
+            // An upper bound, as short-circuiting will often skip part of it.
+            cost = outNodeCosts[node.left] + outNodeCosts[node.right];
+        }
 
-            bool rhs = evalStack.top();
-            evalStack.pop();
+        outNodeCosts[index] = cost;
+    }
 
-            evalStack.push(lhs || rhs);
-            break;
-        }
-        case ShapeOperations::Difference:
+    return outNodeCosts[nodeIndex];
+}
+
+size_t CompositeShape::EmitReorderedNode(size_t nodeIndex, const std::vector<size_t>& trueCounts, const std::vector<double>& nodeCosts,
+    size_t numSamples, ResourceVector<CompositeNode>& outNodes) const
+{
+    // Like CopySimplifiedNode(), each node is either emitted straight away or has its operands scheduled ahead of the operation
+    // that joins them, so the nodes come out in postorder without recursing.
+    struct Task
+    {
+        size_t node; // The node to emit, or s_InvalidIndex to join the last two results with the operation.
+        ShapeOperations operation;
+    };
+
+    std::vector<Task> tasks;
+    std::vector<size_t> results;
+
+    Task root = { nodeIndex, ShapeOperations::Invalid };
+    tasks.push_back(root);
+
+    while (!tasks.empty())
+    {
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        if (task.node == s_InvalidIndex)
         {
-            bool lhs = evalStack.top();
-            evalStack.pop();
+            CompositeNode operation;
+            operation.operation = task.operation;
+            operation.right = results.back();
+            results.pop_back();
+            operation.left = results.back();
+            results.pop_back();
+            outNodes.push_back(operation);
+            results.push_back(outNodes.size() - 1);
+            continue;
+        }
+
+        const CompositeNode& node = m_nodes[task.node];
 
-            bool rhs = evalStack.top();
-            evalStack.pop();
+        switch (node.operation)
+        {
+        case ShapeOperations::Shape:
+            outNodes.push_back(node);
+            results.push_back(outNodes.size() - 1);
+            break;
 
-            evalStack.push(lhs && !rhs); // TODO(jwerner) this could very well be wrong if lhs and rhs are mixed up.
+        case ShapeOperations::Difference:
+        {
+            // Not commutative, so only its operands' insides can be reordered.
+            Task join = { s_InvalidIndex, node.operation };
+            Task right = { node.right, ShapeOperations::Invalid };
+            Task left = { node.left, ShapeOperations::Invalid };
+            tasks.push_back(join);
+            tasks.push_back(right);
+            tasks.push_back(left);
             break;
         }
+        case ShapeOperations::Union:
         case ShapeOperations::Intersection:
         {
-            bool lhs = evalStack.top();
-            evalStack.pop();
+            // Any order of a run of the same operation gives the same result, so put the operands that most cheaply settle it first.
+            // An operand settles a union by containing the point, and an intersection by not containing it.
+            std::vector<size_t> operands;
+            GatherOperands(task.node, node.operation, operands);
 
-            bool rhs = evalStack.top();
-            evalStack.pop();
+            const bool isUnion = (node.operation == ShapeOperations::Union);
+            std::vector<std::pair<double, size_t>> rankedOperands;
+            rankedOperands.reserve(operands.size());
+            for (size_t operand : operands)
+            {
+                size_t numSettled = isUnion ? trueCounts[operand] : (numSamples - trueCounts[operand]);
+                double settleChance = std::max(static_cast<double>(numSettled) / static_cast<double>(numSamples), s_MinSettleChance);
+                rankedOperands.push_back(std::make_pair(nodeCosts[operand] / settleChance, operand));
+            }
+            std::stable_sort(rankedOperands.begin(), rankedOperands.end(),
+                [](const std::pair<double, size_t>& lhs, const std::pair<double, size_t>& rhs) { return lhs.first < rhs.first; });
 
-            evalStack.push(lhs && rhs);
+            // Re-emit the run as a left-leaning chain, so the first operand is evaluated first. The tasks are pushed in reverse, so
+            // they come out in order.
+            for (size_t i = rankedOperands.size(); i-- > 0;)
+            {
+                if (i > 0)
+                {
+                    Task join = { s_InvalidIndex, node.operation };
+                    tasks.push_back(join);
+                }
+                Task operand = { rankedOperands[i].second, ShapeOperations::Invalid };
+                tasks.push_back(operand);
+            }
             break;
         }
         default:
-            dbLogf("Invalid shape operation %d. This should have been caught much earlier.", node.operation);
-            return false;
+            dbLogf("Invalid shape operation %d", node.operation);
+            results.push_back(static_cast<size_t>(s_InvalidIndex)); // A copy, since push_back() takes a reference.
+            break;
         }
     }
 
-    // The last bool on the evaluation stack is the result.
-    if (evalStack.size() != 1)
-    {
-        dbLogf("Invalid number of results on the stack: %d", evalStack.size());
-        return false;
-    }
-    bool result = evalStack.top();
-    evalStack.pop();
-    return result;
-}
-
-double CompositeShape::CalcVolume() const
-{
-    // TODO(jwerner) This will require numerical integration. The result should probably be cached.
-    return 0.0;
+    return results.back();
 }
@@ -5,8 +5,15 @@
 #ifndef INCLUDED_COMPOSITESHAPE_H
 #define INCLUDED_COMPOSITESHAPE_H
 
+#include "BoundingBox.h"
+#include "CompositeInstance.h"
+#include "CompositeShapeDesc.h"
+#include "MemoryResource.h"
 #include "ShapePrimitives/Cuboid.h"
+#include "ShapePrimitives/Module.h"
+#include "ShapePrimitives/Prism.h"
 
+#include <memory>
 #include <vector>
 
 /////////////////////////////////////////////////////////////////////////
@@ -15,6 +22,9 @@ enum class CSGShapes
 {
     Invalid = -1,
     Cuboid = 0,
+    Module = 1,
+    Composite = 2,
+    Prism = 3,
 };
 
 enum class ShapeOperations
@@ -32,26 +42,65 @@ class CompositeShape
 {
 public:
     CompositeShape();
+    explicit CompositeShape(MemoryResource* resource); // All of the composite's storage comes from the resource, which must outlive it.
 
     bool Contains(const Vector4& point) const; // The point is treated as a 3D vector.
 
-    double CalcVolume() const;
+    // Exact for cuboids, prisms, and operations whose operands don't overlap. Modules, and the regions where operands overlap,
+    // are sampled on a grid of roughly sampleSpacing, or of an eighth of the thinnest primitive if it isn't positive.
+    double CalcVolume(double sampleSpacing) const;
+    BoundingBox CalcBounds() const;
 
-    inline void Union(const CSGCuboid& cuboid)
-    {
-        // TODO(jwerner) remove. this is a quick add for testing
-        ShapeUnion shapeUnion;
-        shapeUnion.shapeType = CSGShapes::Cuboid;
-        shapeUnion.cuboid = cuboid;
-        m_shapes.push_back(shapeUnion);
-
-        CompositeNode node;
-        node.operation = ShapeOperations::Shape;
-        node.shape = m_shapes.size() - 1;
-        m_nodes.push_back(node);
-    }
+    // Whether the two composites share any volume. Cuboids, prisms and placed composites are tested exactly. Module leaves are tested by their
+    // bounds, and a Difference only rules an overlap out when its right operand swallows the whole overlapping region, so this errs on the side
+    // of reporting an overlap.
+    bool Overlaps(const CompositeShape& other) const;
+
+    // Each of these combines the cuboid with everything already in the composite.
+    void Union(const CSGCuboid& cuboid);
+    void Difference(const CSGCuboid& cuboid);
+    void Intersection(const CSGCuboid& cuboid);
+
+    void Union(const CSGModuleInstance& module);
+    void Difference(const CSGModuleInstance& module);
+    void Intersection(const CSGModuleInstance& module);
+
+    void Union(const CSGCompositeInstance& composite);
+    void Difference(const CSGCompositeInstance& composite);
+    void Intersection(const CSGCompositeInstance& composite);
+
+    void Union(const CSGPrism& prism);
+    void Difference(const CSGPrism& prism);
+    void Intersection(const CSGPrism& prism);
+
+    // Replaces the contents of the composite in one pass, reserving storage exactly once. Composite primitives index into
+    // placeableComposites. Returns false and leaves the composite empty if the operations don't describe a single tree over
+    // all of the primitives.
+    bool Build(const CompositeShapeDesc& desc, const std::shared_ptr<const CompositeShape>* placeableComposites, size_t numPlaceableComposites);
+
+    // Profiles the composite over the sample points, then rebuilds its nodes so that each run of unions or intersections tries
+    // first the operands that most cheaply settle the run for those points. Contains() stops at the first operand that settles
+    // it. This doesn't change what the composite contains, so the version stays the same.
+    void ReorderOperands(const Vector4* samplePoints, size_t numSamplePoints);
+
+    // Creates a cheaper approximation for coarse levels of detail. Difference operands smaller than minDifferenceSize along
+    // every axis are dropped, unioned cuboids that share a whole face are merged into one, and so are unioned prisms that
+    // share a frame and a height.
+    CompositeShape CreateSimplified(double minDifferenceSize) const;
+    CompositeShape CreateSimplified(double minDifferenceSize, MemoryResource* resource) const;
+
+
+    void CalcMemoryUsage(CompositeMemoryUsage& inOutUsage) const; // Adds this composite's primitives and nodes.
+
+    size_t NumPrimitives() const { return m_shapes.size(); }
+    unsigned int GetVersion() const { return m_version; } // Changes whenever the composite does, so derived data can tell when it is stale.
     
 private:
+    static const size_t s_InvalidIndex = static_cast<size_t>(-1);
+    static const int s_VolumeSamplesPerPrimitive = 8; // Across the smallest primitive, when no sample spacing is given.
+    static const int s_MinVolumeSamplesPerAxis = 4; // So thin regions are never missed between samples.
+    static const int s_MaxVolumeSamplesPerAxis = 128; // Per sampled region, so a sliver of a primitive can't make sampling explode.
+
     struct ShapeUnion
     {
         ShapeUnion()
@@ -60,9 +109,12 @@ private:
         }
 
         CSGShapes shapeType;
+        CSGCuboid cuboid; // Kept out of the union, since standard C++ doesn't allow members with constructors in anonymous unions.
         union
         {
-            struct { CSGCuboid cuboid; }; // Wrapped in a struct to let the union work.
+            size_t module; // Indexes into m_modules, since module instances own a reference to their module.
+            size_t composite; // Indexes into m_composites, for the same reason.
+            size_t prism; // Indexes into m_prisms, since prisms own their edge tables.
         };
     };
 
@@ -70,26 +122,71 @@ private:
     {
         CompositeNode()
             : operation(ShapeOperations::Invalid)
-            , left(nullptr)
-            , right(nullptr)
-            , shape(-1)
+            , left(s_InvalidIndex)
+            , right(s_InvalidIndex)
         {
         }
 
         ShapeOperations operation;
         union // This union is here to make it apparent that a node either has left & right or a shapeIndex, but is it actually any clearer?
         {
-            struct // Accessible when operation != Shape
+            struct // Accessible when operation != Shape. Indexes into m_nodes rather than pointers so composites can be copied.
             {
-                CompositeNode* left;
-                CompositeNode* right;
+                size_t left;
+                size_t right;
             };
             size_t shape; // Accessible when operation == Shape
         };
     };
 
-    std::vector<ShapeUnion> m_shapes;
-    std::vector<CompositeNode> m_nodes;
+    // Subtracting from or intersecting with nothing leaves nothing. Checked before a primitive is stored, so every stored
+    // module, composite and prism has a node of its own.
+    bool LeavesNothing(ShapeOperations operation) const { return m_root == s_InvalidIndex && operation != ShapeOperations::Union; }
+    void Combine(ShapeOperations operation, const ShapeUnion& shape);
+    void Combine(ShapeOperations operation, const CSGModuleInstance& module);
+    void Combine(ShapeOperations operation, const CSGCompositeInstance& composite);
+    void Combine(ShapeOperations operation, const CSGPrism& prism);
+    size_t AddShapeNode(const ShapeUnion& shape);
+    void Clear();
+    size_t CopyShapeNode(const CompositeShape& source, size_t sourceShape);
+    size_t AddOperationNode(ShapeOperations operation, size_t left, size_t right);
+
+    BoundingBox CalcShapeBounds(size_t shapeIndex) const;
+    void FillNodeBounds(size_t nodeIndex, std::vector<BoundingBox>& outNodeBounds) const; // outNodeBounds must already be sized to m_nodes.
+    void CollectPostorder(size_t nodeIndex, std::vector<size_t>& outPostorder) const; // The subtree's nodes, each after its operands.
+
+    bool NodeOverlaps(size_t nodeIndex, const std::vector<BoundingBox>& nodeBounds,
+        const CompositeShape& other, size_t otherNode, const std::vector<BoundingBox>& otherNodeBounds) const;
+    bool LeafOverlaps(size_t nodeIndex, const CompositeShape& other, size_t otherNode) const;
+    bool PlacementOverlaps(const CSGCompositeInstance& placement, const CompositeShape& other, size_t otherNode) const;
+    void Transform(const Matrix4x4& transform); // Moves every primitive by a rigid transformation.
+    bool NodeContainsBox(size_t nodeIndex, const BoundingBox& box, const std::vector<BoundingBox>& nodeBounds) const;
+    void CalcLeafCuboid(size_t nodeIndex, CSGCuboid& outCuboid) const; // Modules and composites are approximated by their bounds.
+    size_t CopySimplifiedNode(const CompositeShape& source, size_t sourceNode, const std::vector<BoundingBox>& sourceNodeBounds,
+        double minDifferenceSize);
+    void GatherOperands(size_t nodeIndex, ShapeOperations operation, std::vector<size_t>& outOperands) const; // Flattens a run of the operation.
+
+    // Adds the part of the box inside the bounds of each of the node's leaves, skipping any without volume.
+    void CollectLeafRegions(size_t nodeIndex, const BoundingBox& box, const std::vector<BoundingBox>& nodeBounds,
+        std::vector<BoundingBox>& outRegions) const;
+    double SampleVolume(const std::vector<BoundingBox>& regions, size_t nodeIndex, size_t otherNode, double sampleSpacing) const;
+
+    bool NodeContains(size_t nodeIndex, const Vector4& point) const;
+    bool WalkContainsThroughPlacements(size_t nodeIndex, const Vector4& point) const;
+    bool ShapeContains(size_t shapeIndex, const Vector4& point) const;
+    void ProfileNodes(const std::vector<size_t>& postorder, const Vector4& point, std::vector<char>& scratchResults,
+        std::vector<size_t>& inOutTrueCounts) const; // scratchResults must already be sized to m_nodes.
+    double CalcNodeCost(size_t nodeIndex, std::vector<double>& outNodeCosts) const; // outNodeCosts must already be sized to m_nodes.
+    size_t EmitReorderedNode(size_t nodeIndex, const std::vector<size_t>& trueCounts, const std::vector<double>& nodeCosts,
+        size_t numSamples, ResourceVector<CompositeNode>& outNodes) const;
+
+    ResourceVector<ShapeUnion> m_shapes;
+    ResourceVector<CompositeNode> m_nodes;
+    ResourceVector<CSGModuleInstance> m_modules;
+    ResourceVector<CSGCompositeInstance> m_composites;
+    ResourceVector<CSGPrism> m_prisms;
+    size_t m_root;
+    unsigned int m_version;
     Vector4 m_position; // Treated as a 3D vector.
 };
 
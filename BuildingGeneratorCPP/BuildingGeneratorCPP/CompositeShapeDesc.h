@@ -0,0 +1,35 @@
+// Plain data descriptions of composite shapes, laid out so they can be filled in directly from Unity.
+
+#pragma once
+
+#ifndef INCLUDED_COMPOSITE_SHAPE_DESC_H
+#define INCLUDED_COMPOSITE_SHAPE_DESC_H
+
+#include <cstddef>
+
+struct CSGPrimitiveDesc
+{
+    double position[3];
+    double dimensions[3]; // For CSGShapes::Prism, only y is used, as the height.
+    double orientation[4]; // Quaternion a, b, c, d.
+    double moduleParameters[6]; // For CSGShapes::Module, the measurements besides its dimensions. See CreateBuildingModule().
+    int shapeType; // A CSGShapes value. The ints are kept last so the doubles need no padding on either side of the P/Invoke boundary.
+    int compositeID; // For CSGShapes::Composite, the existing composite to place. Its dimensions are ignored.
+    int firstPoint; // For CSGShapes::Prism, the range of CompositeShapeDesc::points holding its outline. See CSGPrism for the format.
+    int numPoints;
+    int moduleType; // For CSGShapes::Module, a BuildingModuleType.
+};
+
+// A composite is described by its primitives and a postorder list of ShapeOperations. Every Shape entry in the list
+// consumes the next primitive in order, and every other operation combines the two entries before it.
+struct CompositeShapeDesc
+{
+    const CSGPrimitiveDesc* primitives;
+    size_t numPrimitives;
+    const int* operations;
+    size_t numOperations;
+    const double* points; // x, z pairs shared by all of the prisms.
+    size_t numPoints;
+};
+
+#endif // INCLUDED_COMPOSITE_SHAPE_DESC_H
@@ -1,9 +1,231 @@
 
 #include "CompositeShapeManager.h"
 
-CompositeShapeManager CompositeShapeManager::s_Instance = CompositeShapeManager();
+#include <algorithm>
+#include <cmath>
+
+CompositeShapeManager CompositeShapeManager::s_Instance;
+
+CompositeShapeID CompositeShapeManager::CreateComposite(const CompositeShapeDesc& desc)
+{
+    std::shared_ptr<CompositeShape> composite = std::allocate_shared<CompositeShape>(ResourceAllocator<CompositeShape>(&m_resource), &m_resource);
+    if (!composite->Build(desc, m_shapes.data(), m_shapes.size()))
+    {
+        return INVALID_COMPOSITE_SHAPE_ID;
+    }
+
+    BoundingBox bounds = composite->CalcBounds();
+    if (m_numProfilingSamples > 0 && !bounds.IsEmpty())
+    {
+        // Sample the middle of each cell of a regular grid, which is how the mesher will query the composite.
+        int samplesPerAxis = std::max(static_cast<int>(std::pow(static_cast<double>(m_numProfilingSamples), 1.0 / 3.0) + 0.5), 1);
+        Vector4 cellSize = bounds.CalcSize() * (1.0 / samplesPerAxis);
+
+        std::vector<Vector4> samples;
+        samples.reserve(samplesPerAxis * samplesPerAxis * samplesPerAxis);
+        for (int x = 0; x < samplesPerAxis; ++x)
+        {
+            for (int y = 0; y < samplesPerAxis; ++y)
+            {
+                for (int z = 0; z < samplesPerAxis; ++z)
+                {
+                    samples.push_back(Vector4(
+                        bounds.minCorner.x + ((x + 0.5) * cellSize.x),
+                        bounds.minCorner.y + ((y + 0.5) * cellSize.y),
+                        bounds.minCorner.z + ((z + 0.5) * cellSize.z),
+                        1.0));
+                }
+            }
+        }
+        composite->ReorderOperands(samples.data(), samples.size());
+    }
+
+    m_shapes.push_back(std::move(composite));
+    return static_cast<CompositeShapeID>(m_shapes.size() - 1);
+}
+
+CompositeShapeID CompositeShapeManager::CreateComposite(const BuildingLevelDesc& level)
+{
+    std::vector<CSGPrimitiveDesc> primitives;
+    std::vector<int> operations;
+    std::vector<double> points;
+    DescribeBuildingLevel(level, primitives, operations, points);
+
+    CompositeShapeDesc desc;
+    desc.primitives = primitives.data();
+    desc.numPrimitives = primitives.size();
+    desc.operations = operations.data();
+    desc.numOperations = operations.size();
+    desc.points = points.data();
+    desc.numPoints = points.size() / 2;
+    return CreateComposite(desc);
+}
 
 bool CompositeShapeManager::CompositeContains(CompositeShapeID id, const Vector4& position) const
 {
-    return m_shapes[id].Contains(position);
+    return m_shapes[id]->Contains(position);
+}
+
+void CompositeShapeManager::GetMemoryUsage(CompositeShapeID id, CompositeMemoryUsage& outUsage) const
+{
+    outUsage = CompositeMemoryUsage();
+    m_shapes[id]->CalcMemoryUsage(outUsage);
+
+    if (static_cast<size_t>(id) < m_bounds.size())
+    {
+        outUsage.caches += sizeof(CachedBounds);
+    }
+
+    auto lodChain = m_lodChains.find(id);
+    if (lodChain != m_lodChains.end())
+    {
+        lodChain->second.CalcMemoryUsage(outUsage);
+    }
+}
+
+const CompositeLODChain& CompositeShapeManager::GetLODChain(CompositeShapeID id, double baseVoxelSize, size_t numLevels)
+{
+    const CompositeShape& composite = *m_shapes[id];
+    auto found = m_lodChains.find(id);
+    if (found == m_lodChains.end())
+    {
+        // Cached meshes live as long as the composite, so the chain draws from the same pool.
+        found = m_lodChains.insert(std::make_pair(id, CompositeLODChain(&m_resource))).first;
+    }
+    CompositeLODChain& chain = found->second;
+
+    if (!chain.IsCurrent(composite, baseVoxelSize, numLevels))
+    {
+        chain.Generate(composite, baseVoxelSize, numLevels);
+    }
+    return chain;
+}
+
+const BoundingBox& CompositeShapeManager::GetCompositeBounds(CompositeShapeID id)
+{
+    if (m_bounds.size() < m_shapes.size())
+    {
+        m_bounds.resize(m_shapes.size());
+    }
+
+    const CompositeShape& composite = *m_shapes[id];
+    CachedBounds& cached = m_bounds[id];
+
+    if (!cached.valid)
+    {
+        cached.bounds = composite.CalcBounds();
+        cached.valid = true;
+    }
+    return cached.bounds;
+}
+
+bool CompositeShapeManager::CompositesOverlap(CompositeShapeID a, CompositeShapeID b)
+{
+    if (!GetCompositeBounds(a).Overlaps(GetCompositeBounds(b)))
+    {
+        return false;
+    }
+    return m_shapes[a]->Overlaps(*m_shapes[b]);
+}
+
+void CompositeShapeManager::FindOverlappingComposites(std::vector<std::pair<CompositeShapeID, CompositeShapeID>>& outPairs)
+{
+    outPairs.clear();
+    UpdateSweepOrder();
+
+    // Sweep along x, keeping the composites whose x range is still open.
+    std::vector<CompositeShapeID> active;
+    for (CompositeShapeID id : m_sweepOrder)
+    {
+        const BoundingBox& bounds = m_bounds[id].bounds;
+        if (bounds.IsEmpty())
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < active.size();)
+        {
+            if (m_bounds[active[i]].bounds.maxCorner.x < bounds.minCorner.x)
+            {
+                active[i] = active.back();
+                active.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        for (CompositeShapeID other : active)
+        {
+            if (m_bounds[other].bounds.Overlaps(bounds) && m_shapes[other]->Overlaps(*m_shapes[id]))
+            {
+                outPairs.push_back(std::make_pair(std::min(id, other), std::max(id, other)));
+            }
+        }
+
+        active.push_back(id);
+    }
+}
+
+void CompositeShapeManager::FindPlacementOverlaps(CompositeShapeID id, const Vector4& position, const Quaternion& orientation,
+    std::vector<CompositeShapeID>& outIds)
+{
+    outIds.clear();
+    UpdateSweepOrder();
+
+    // Nothing from the previous query is still alive, so its scratch memory can all be reused.
+    m_placementScratch.Release();
+
+    CompositeShape placed(&m_placementScratch);
+    placed.Union(CSGCompositeInstance(m_shapes[id], position, orientation));
+    BoundingBox placedBounds = placed.CalcBounds();
+    if (placedBounds.IsEmpty())
+    {
+        return;
+    }
+
+    // Composites are sorted by minimum x, so none from the first one starting past the moved bounds onwards can overlap them.
+    for (CompositeShapeID other : m_sweepOrder)
+    {
+        const BoundingBox& bounds = m_bounds[other].bounds;
+        if (bounds.minCorner.x > placedBounds.maxCorner.x)
+        {
+            break;
+        }
+        if (other != id && bounds.Overlaps(placedBounds) && placed.Overlaps(*m_shapes[other]))
+        {
+            outIds.push_back(other);
+        }
+    }
+    std::sort(outIds.begin(), outIds.end());
+}
+
+void CompositeShapeManager::UpdateSweepOrder()
+{
+    for (CompositeShapeID id = static_cast<CompositeShapeID>(m_sweepOrder.size()), end = static_cast<CompositeShapeID>(m_shapes.size()); id < end; ++id)
+    {
+        m_sweepOrder.push_back(id);
+    }
+
+    // Refresh the bounds up front so the sort below compares current values.
+    for (CompositeShapeID id = 0, end = static_cast<CompositeShapeID>(m_shapes.size()); id < end; ++id)
+    {
+        GetCompositeBounds(id);
+    }
+
+    // Insertion sort is close to linear when little has moved since the last sweep.
+    for (size_t i = 1; i < m_sweepOrder.size(); ++i)
+    {
+        CompositeShapeID id = m_sweepOrder[i];
+        double minX = m_bounds[id].bounds.minCorner.x;
+
+        size_t j = i;
+        while (j > 0 && m_bounds[m_sweepOrder[j - 1]].bounds.minCorner.x > minX)
+        {
+            m_sweepOrder[j] = m_sweepOrder[j - 1];
+            --j;
+        }
+        m_sweepOrder[j] = id;
+    }
 }
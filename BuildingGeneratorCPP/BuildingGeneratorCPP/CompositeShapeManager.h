@@ -8,28 +8,101 @@
 #include "Vector4.h"
 #include "Quaternion.h"
 #include "CompositeShape.h"
+#include "CompositeLODChain.h"
+#include "CompositeShapeDesc.h"
+#include "BuildingLevelBuilder.h"
+#include "MemoryResource.h"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 typedef int CompositeShapeID;
 
+const CompositeShapeID INVALID_COMPOSITE_SHAPE_ID = -1;
+
 class CompositeShapeManager
 {
 public:
     static CompositeShapeManager s_Instance;
 
     CompositeShapeManager()
-        : m_shapes()
+        : m_resource(GetDefaultMemoryResource())
+        , m_shapes(&m_resource)
+        , m_lodChains(std::less<CompositeShapeID>(), &m_resource)
+        , m_bounds(&m_resource)
+        , m_sweepOrder(&m_resource)
+        , m_placementScratch(s_PlacementScratchBlockSize, GetDefaultMemoryResource())
+        , m_numProfilingSamples(0)
     {
-        // Quick dumb setup TODO(jwerner) remove
-        CSGCuboid cuboid(Vector4(), Vector4(1.0, 1.0, 1.0, 1.0), Quaternion());
-        CompositeShape compositeTest;
-        compositeTest.Union(cuboid);
-        m_shapes.push_back(compositeTest);
     }
 
+    // While non-zero, every new composite is profiled over about this many points spread through its bounds before anything else
+    // can see it, and its operands are reordered to suit. See CompositeShape::ReorderOperands().
+    void SetOperandProfiling(size_t numSamplePoints) { m_numProfilingSamples = numSamplePoints; }
+
+    // Builds a whole composite in one go. See CompositeShapeDesc for the format. Composite primitives may place any composite
+    // created before this one. Returns INVALID_COMPOSITE_SHAPE_ID if the description is malformed.
+    CompositeShapeID CreateComposite(const CompositeShapeDesc& desc);
+    CompositeShapeID CreateComposite(const BuildingLevelDesc& level);
+
     bool CompositeContains(CompositeShapeID id, const Vector4& position) const;
 
+    // Reports the bytes held by the composite and everything cached for it. Only what has already been derived is counted.
+    void GetMemoryUsage(CompositeShapeID id, CompositeMemoryUsage& outUsage) const;
+
+    size_t NumComposites() const { return m_shapes.size(); }
+    bool IsValidComposite(CompositeShapeID id) const { return id >= 0 && static_cast<size_t>(id) < m_shapes.size(); } // The other methods expect a valid ID.
+    const CompositeShape& GetComposite(CompositeShapeID id) const { return *m_shapes[id]; }
+
+    // Generates the composite's LOD chain the first time it is asked for, and again only once the composite or the settings change.
+    const CompositeLODChain& GetLODChain(CompositeShapeID id, double baseVoxelSize, size_t numLevels);
+
+    // Bounds are calculated the first time they are asked for. Composites never change once created, so they stay valid.
+    const BoundingBox& GetCompositeBounds(CompositeShapeID id);
+
+    bool CompositesOverlap(CompositeShapeID a, CompositeShapeID b);
+
+    // Finds every pair of overlapping composites, lower ID first. A sweep and prune over the composites' bounds finds the
+    // candidate pairs, and only those are tested exactly.
+    void FindOverlappingComposites(std::vector<std::pair<CompositeShapeID, CompositeShapeID>>& outPairs);
+
+    // Finds every other composite that the composite would overlap if it were moved to the position and orientation, lowest ID
+    // first, without creating anything. The composite is tested through a placement rather than moved, and the candidates come
+    // from the same sweep order as FindOverlappingComposites(). Suited to testing many candidate placements of the same composite.
+    void FindPlacementOverlaps(CompositeShapeID id, const Vector4& position, const Quaternion& orientation, std::vector<CompositeShapeID>& outIds);
+
 private:
-    std::vector<CompositeShape> m_shapes;
+    CompositeShapeManager(const CompositeShapeManager&);
+    void operator=(const CompositeShapeManager&);
+
+    static const size_t s_PlacementScratchBlockSize = 64 * 1024;
+
+    void UpdateSweepOrder(); // Adds any new composites, refreshes every composite's bounds, and re-sorts.
+
+    struct CachedBounds
+    {
+        CachedBounds()
+            : bounds()
+            , valid(false)
+        {
+        }
+
+        BoundingBox bounds;
+        bool valid;
+    };
+
+    PoolMemoryResource m_resource; // Composites live as long as the manager, and are made of many small containers. Declared first so it is destroyed last.
+
+    // Composites never move, so mesh streams can keep referring to them as more are added. They are never changed once created
+    // either, which lets later composites place them.
+    ResourceVector<std::shared_ptr<const CompositeShape>> m_shapes;
+    ResourceMap<CompositeShapeID, CompositeLODChain> m_lodChains;
+    ResourceVector<CachedBounds> m_bounds;
+    ResourceVector<CompositeShapeID> m_sweepOrder; // Sorted by minimum x. Kept between sweeps, since it will still be nearly sorted.
+    MonotonicMemoryResource m_placementScratch; // Each placement query's temporary composites. Reset by the next query.
+    size_t m_numProfilingSamples;
 };
 
 #endif // INCLUDED_COMPOSITE_SHAPE_MANAGER_H
@@ -77,14 +77,11 @@ Matrix4x4 Matrix4x4::CalcInverse() const
 // Algorithm from http://graphics.stanford.edu/courses/cs248-98-fall/Final/q4.html
 Matrix4x4 Matrix4x4::CalcInverseTransform() const
 {
-    dbBreakf("test");
+    dbAssertf(data[0][3] != 0.0, "Matrix is not a transformation matrix.");
+    dbAssertf(data[1][3] != 0.0, "Matrix is not a transformation matrix.");
+    dbAssertf(data[2][3] != 0.0, "Matrix is not a transformation matrix.");
 
-    dbAssertf(data[0][3] == 0.0, "Matrix is not a transformation matrix.");
-    dbAssertf(data[1][3] == 0.0, "Matrix is not a transformation matrix.");
-    dbAssertf(data[2][3] == 0.0, "Matrix is not a transformation matrix.");
-    dbAssertf(data[3][3] == 1.0, "Matrix is not a transformation matrix.");
-
-    // Transpose the rotations, and the translation is the dot of the rotations with itself.
+    // Transpose the rotations, and the translation is the negated dot of the rotations with itself.
     Matrix4x4 out;
 
     for (size_t i = 0; i < 3; ++i)
@@ -100,14 +97,24 @@ Matrix4x4 Matrix4x4::CalcInverseTransform() const
     const double* w = data[2];
     const double* t = data[3];
 
-    out[3][0] = (u[0] * t[0]) + (u[1] * t[1]) + (u[2] * t[2]);
-    out[3][1] = (v[0] * t[0]) + (v[1] * t[1]) + (v[2] * t[2]);
-    out[3][2] = (w[0] * t[0]) + (w[1] * t[1]) + (w[2] * t[2]);
+    out[3][0] = -((u[0] * t[0]) + (u[1] * t[1]) + (u[2] * t[2]));
+    out[3][1] = -((v[0] * t[0]) + (v[1] * t[1]) + (v[2] * t[2]));
+    out[3][2] = -((w[0] * t[0]) + (w[1] * t[1]) + (w[2] * t[2]));
     out[3][3] = 1.0;
 
     return out;
 }
 
+Vector4 Matrix4x4::TransformPoint(const Vector4& point) const
+{
+    // Column major, so data[column][row].
+    double outX = (data[0][0] * point.x) + (data[1][0] * point.y) + (data[2][0] * point.z) + data[3][0];
+    double outY = (data[0][1] * point.x) + (data[1][1] * point.y) + (data[2][1] * point.z) + data[3][1];
+    double outZ = (data[0][2] * point.x) + (data[1][2] * point.y) + (data[2][2] * point.z) + data[3][2];
+
+    return Vector4(outX, outY, outZ, 1.0);
+}
+
 void Matrix4x4::operator=(const Matrix4x4& rhs)
 {
     for (size_t i = 0; i < 4; ++i)
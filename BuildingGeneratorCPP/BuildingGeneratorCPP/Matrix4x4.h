@@ -7,6 +7,8 @@
 
 #include "Vector4.h"
 
+#include <cstddef>
+
 class Quaternion;
 
 class Matrix4x4
@@ -25,21 +27,29 @@ public:
     Matrix4x4 CalcInverse() const;
     Matrix4x4 CalcInverseTransform() const; // Calculates the inverse quickly for transformation matricies.
 
+    Vector4 TransformPoint(const Vector4& point) const; // The point is treated as a 3D position, so the translation applies.
+
     void operator=(const Matrix4x4& rhs);
 
 private:
     double data[4][4];
 };
 
+// Applies rhs first, then lhs. Column major, so out[column][row].
 inline Matrix4x4 operator*(const Matrix4x4& lhs, const Matrix4x4& rhs)
 {
     Matrix4x4 out;
 
-    for (size_t i = 0; i < 4; ++i)
+    for (size_t column = 0; column < 4; ++column)
     {
-        for (size_t j = 0; j < 4; ++j)
+        for (size_t row = 0; row < 4; ++row)
         {
-            out[i][j] = lhs[i][j] * rhs[j][i];
+            double sum = 0.0;
+            for (size_t k = 0; k < 4; ++k)
+            {
+                sum += lhs[k][row] * rhs[column][k];
+            }
+            out[column][row] = sum;
         }
     }
 
@@ -0,0 +1,177 @@
+
+#include "MemoryResource.h"
+#include "DebugUtils.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+    class NewDeleteMemoryResource : public MemoryResource
+    {
+    public:
+        virtual void* Allocate(size_t bytes, size_t alignment)
+        {
+            dbAssertf(alignment > 16, "Alignment %d is more than operator new guarantees.", alignment);
+            static_cast<void>(alignment); // Only read by the assert, which isn't always compiled in.
+            return ::operator new(bytes);
+        }
+
+        virtual void Deallocate(void* memory, size_t /*bytes*/, size_t /*alignment*/)
+        {
+            ::operator delete(memory);
+        }
+    };
+
+    char* AlignUp(char* address, size_t alignment)
+    {
+        uintptr_t value = reinterpret_cast<uintptr_t>(address);
+        return reinterpret_cast<char*>((value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+    }
+}
+
+MemoryResource* GetDefaultMemoryResource()
+{
+    // The first call comes from static initialisation, before any other threads exist, so this is safe without magic statics.
+    static NewDeleteMemoryResource s_DefaultResource;
+    return &s_DefaultResource;
+}
+
+// ------------------------------------------------------------------------
+
+MonotonicMemoryResource::MonotonicMemoryResource(size_t initialBlockSize, MemoryResource* upstream)
+    : m_blocks(nullptr)
+    , m_current(nullptr)
+    , m_end(nullptr)
+    , m_nextBlockSize(std::max(initialBlockSize, sizeof(Block) * 2))
+    , m_upstream(upstream)
+{
+}
+
+MonotonicMemoryResource::~MonotonicMemoryResource()
+{
+    Release();
+
+    if (m_blocks != nullptr)
+    {
+        m_upstream->Deallocate(m_blocks, m_blocks->size, s_BlockAlignment);
+    }
+}
+
+void* MonotonicMemoryResource::Allocate(size_t bytes, size_t alignment)
+{
+    char* memory = AlignUp(m_current, alignment);
+    if (m_current == nullptr || memory + bytes > m_end)
+    {
+        // Grow geometrically so that a job which allocates a lot only goes upstream a handful of times.
+        size_t blockSize = std::max(m_nextBlockSize, sizeof(Block) + bytes + alignment);
+        m_nextBlockSize = blockSize * 2;
+
+        Block* block = static_cast<Block*>(m_upstream->Allocate(blockSize, s_BlockAlignment));
+        block->next = m_blocks;
+        block->size = blockSize;
+        m_blocks = block;
+
+        m_current = reinterpret_cast<char*>(block + 1);
+        m_end = reinterpret_cast<char*>(block) + blockSize;
+        memory = AlignUp(m_current, alignment);
+    }
+
+    m_current = memory + bytes;
+    return memory;
+}
+
+void MonotonicMemoryResource::Release()
+{
+    if (m_blocks == nullptr)
+    {
+        return;
+    }
+
+    // Keep the oldest block, since the next job will most likely need at least as much again.
+    while (m_blocks->next != nullptr)
+    {
+        Block* next = m_blocks->next;
+        m_upstream->Deallocate(m_blocks, m_blocks->size, s_BlockAlignment);
+        m_blocks = next;
+    }
+
+    m_current = reinterpret_cast<char*>(m_blocks + 1);
+    m_end = reinterpret_cast<char*>(m_blocks) + m_blocks->size;
+}
+
+// ------------------------------------------------------------------------
+
+PoolMemoryResource::PoolMemoryResource(MemoryResource* upstream)
+    : m_slabs()
+    , m_upstream(upstream)
+    , m_mutex()
+{
+    std::fill(m_freeLists, m_freeLists + s_NumClasses, nullptr);
+}
+
+PoolMemoryResource::~PoolMemoryResource()
+{
+    for (void* slab : m_slabs)
+    {
+        m_upstream->Deallocate(slab, s_SlabSize, s_SlabAlignment);
+    }
+}
+
+void* PoolMemoryResource::Allocate(size_t bytes, size_t alignment)
+{
+    // A slot is only aligned to its own size, so small but strictly aligned allocations need a bigger class.
+    size_t classIndex = CalcClassIndex(std::max(bytes, alignment));
+    if (classIndex >= s_NumClasses || alignment > s_SlabAlignment)
+    {
+        return m_upstream->Allocate(bytes, alignment);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    FreeSlot*& freeList = m_freeLists[classIndex];
+    if (freeList == nullptr)
+    {
+        // Carve a whole slab into slots of this class. Slots are a power of two apart, so each is aligned to its own size up to the slab's alignment.
+        size_t slotSize = s_MinClassSize << classIndex;
+        char* slab = static_cast<char*>(m_upstream->Allocate(s_SlabSize, s_SlabAlignment));
+        m_slabs.push_back(slab);
+
+        for (size_t offset = s_SlabSize; offset >= slotSize; offset -= slotSize)
+        {
+            FreeSlot* slot = reinterpret_cast<FreeSlot*>(slab + offset - slotSize);
+            slot->next = freeList;
+            freeList = slot;
+        }
+    }
+
+    FreeSlot* slot = freeList;
+    freeList = slot->next;
+    return slot;
+}
+
+void PoolMemoryResource::Deallocate(void* memory, size_t bytes, size_t alignment)
+{
+    size_t classIndex = CalcClassIndex(std::max(bytes, alignment)); // The same class Allocate() chose.
+    if (classIndex >= s_NumClasses || alignment > s_SlabAlignment)
+    {
+        m_upstream->Deallocate(memory, bytes, alignment);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    FreeSlot* slot = static_cast<FreeSlot*>(memory);
+    slot->next = m_freeLists[classIndex];
+    m_freeLists[classIndex] = slot;
+}
+
+size_t PoolMemoryResource::CalcClassIndex(size_t bytes)
+{
+    size_t classIndex = 0;
+    for (size_t classSize = s_MinClassSize; classSize < bytes; classSize <<= 1)
+    {
+        ++classIndex;
+    }
+    return classIndex;
+}
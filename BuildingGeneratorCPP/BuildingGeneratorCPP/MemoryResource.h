@@ -0,0 +1,195 @@
+// Pluggable sources of memory for the library's containers, along the lines of std::pmr, which Visual Studio 2013 lacks.
+
+#pragma once
+
+#ifndef INCLUDED_MEMORY_RESOURCE_H
+#define INCLUDED_MEMORY_RESOURCE_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() {}
+
+    virtual void* Allocate(size_t bytes, size_t alignment) = 0;
+    virtual void Deallocate(void* memory, size_t bytes, size_t alignment) = 0; // Must be given the same size and alignment as the allocation.
+};
+
+// Plain new and delete. Used wherever no other resource is given.
+MemoryResource* GetDefaultMemoryResource();
+
+// Hands out memory by bumping a pointer through blocks taken from upstream, and only gives it back in one go. Suited to a
+// single generation job whose temporary data all dies together. Not thread safe.
+class MonotonicMemoryResource : public MemoryResource
+{
+public:
+    MonotonicMemoryResource(size_t initialBlockSize, MemoryResource* upstream);
+    virtual ~MonotonicMemoryResource();
+
+    virtual void* Allocate(size_t bytes, size_t alignment);
+    virtual void Deallocate(void* /*memory*/, size_t /*bytes*/, size_t /*alignment*/) {} // Everything is freed by Release().
+
+    void Release(); // Frees every allocation at once. The first block is kept for reuse.
+
+private:
+    MonotonicMemoryResource(const MonotonicMemoryResource&);
+    void operator=(const MonotonicMemoryResource&);
+
+    struct Block
+    {
+        Block* next;
+        size_t size; // Including this header.
+    };
+
+    static const size_t s_BlockAlignment = 16;
+
+    Block* m_blocks; // Most recent first.
+    char* m_current;
+    char* m_end;
+    size_t m_nextBlockSize;
+    MemoryResource* m_upstream;
+};
+
+// Recycles small allocations through free lists, one per power of two size class. Larger allocations go straight upstream.
+// Suited to long-lived shapes, whose many small containers would otherwise churn the heap. Thread safe.
+class PoolMemoryResource : public MemoryResource
+{
+public:
+    explicit PoolMemoryResource(MemoryResource* upstream);
+    virtual ~PoolMemoryResource();
+
+    virtual void* Allocate(size_t bytes, size_t alignment);
+    virtual void Deallocate(void* memory, size_t bytes, size_t alignment);
+
+private:
+    PoolMemoryResource(const PoolMemoryResource&);
+    void operator=(const PoolMemoryResource&);
+
+    static const size_t s_MinClassSize = 8;
+    static const size_t s_NumClasses = 8; // 8 to 1024 bytes.
+    static const size_t s_SlabSize = 64 * 1024;
+    static const size_t s_SlabAlignment = 16;
+
+    static size_t CalcClassIndex(size_t bytes);
+
+    struct FreeSlot
+    {
+        FreeSlot* next;
+    };
+
+    FreeSlot* m_freeLists[s_NumClasses];
+    std::vector<void*> m_slabs;
+    MemoryResource* m_upstream;
+    std::mutex m_mutex;
+};
+
+// Lets standard containers draw from a MemoryResource. Copies share the resource, so it must outlive every container using it.
+template <typename T>
+class ResourceAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef ResourceAllocator<U> other;
+    };
+
+    ResourceAllocator()
+        : m_resource(GetDefaultMemoryResource())
+    {
+    }
+
+    ResourceAllocator(MemoryResource* resource) // Implicit, so containers can be given a resource directly.
+        : m_resource(resource)
+    {
+    }
+
+    template <typename U>
+    ResourceAllocator(const ResourceAllocator<U>& other)
+        : m_resource(other.GetResource())
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(m_resource->Allocate(count * sizeof(T), __alignof(T)));
+    }
+
+    void deallocate(T* memory, size_t count)
+    {
+        m_resource->Deallocate(memory, count * sizeof(T), __alignof(T));
+    }
+
+    template <typename U, typename... TArgs>
+    void construct(U* memory, TArgs&&... args)
+    {
+        ::new(static_cast<void*>(memory)) U(std::forward<TArgs>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* memory)
+    {
+        memory->~U();
+    }
+
+    size_t max_size() const { return static_cast<size_t>(-1) / sizeof(T); }
+
+    T* address(T& value) const { return &value; }
+    const T* address(const T& value) const { return &value; }
+
+    MemoryResource* GetResource() const { return m_resource; }
+
+private:
+    MemoryResource* m_resource;
+};
+
+template <typename T, typename U>
+inline bool operator==(const ResourceAllocator<T>& lhs, const ResourceAllocator<U>& rhs)
+{
+    return lhs.GetResource() == rhs.GetResource();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ResourceAllocator<T>& lhs, const ResourceAllocator<U>& rhs)
+{
+    return lhs.GetResource() != rhs.GetResource();
+}
+
+// Bytes held by one composite and the data derived from it, by what they are used for.
+struct CompositeMemoryUsage
+{
+    CompositeMemoryUsage()
+        : primitives(0)
+        , nodes(0)
+        , caches(0)
+        , meshes(0)
+    {
+    }
+
+    size_t primitives; // Shapes, and module and composite placements. Shared modules and placed composites aren't included.
+    size_t nodes;
+    size_t caches; // Bounds and LOD bookkeeping.
+    size_t meshes; // Cached LOD meshes.
+};
+
+template <typename T>
+using ResourceVector = std::vector<T, ResourceAllocator<T>>;
+
+template <typename TKey, typename TValue>
+using ResourceMap = std::map<TKey, TValue, std::less<TKey>, ResourceAllocator<std::pair<const TKey, TValue>>>;
+
+#endif // INCLUDED_MEMORY_RESOURCE_H
@@ -0,0 +1,46 @@
+
+#include "MeshChunk.h"
+#include "DebugUtils.h"
+
+MeshChunk::MeshChunk()
+    : m_vertices()
+    , m_normals()
+    , m_triangles()
+{
+    m_vertices.reserve(s_MaxVertices * 3);
+    m_normals.reserve(s_MaxVertices * 3);
+    m_triangles.reserve(s_MaxIndices);
+}
+
+void MeshChunk::Clear()
+{
+    // clear() keeps the capacity, which is the whole point of reusing chunks.
+    m_vertices.clear();
+    m_normals.clear();
+    m_triangles.clear();
+}
+
+void MeshChunk::AddQuad(const float corners[4][3], const float normal[3])
+{
+    dbAssertf(!CanFitQuad(), "Mesh chunk overflow: %d vertexes.", NumVertices());
+
+    int first = static_cast<int>(NumVertices());
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            m_vertices.push_back(corners[i][j]);
+            m_normals.push_back(normal[j]);
+        }
+    }
+
+    // Corners are clockwise, so fan the quad from the first corner.
+    m_triangles.push_back(first);
+    m_triangles.push_back(first + 1);
+    m_triangles.push_back(first + 2);
+
+    m_triangles.push_back(first);
+    m_triangles.push_back(first + 2);
+    m_triangles.push_back(first + 3);
+}
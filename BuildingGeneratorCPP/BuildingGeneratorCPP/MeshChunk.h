@@ -0,0 +1,41 @@
+// A bounded block of mesh data that the native mesher hands off to its consumer.
+
+#pragma once
+
+#ifndef INCLUDED_MESH_CHUNK_H
+#define INCLUDED_MESH_CHUNK_H
+
+#include <cstddef>
+#include <vector>
+
+class MeshChunk
+{
+public:
+    // Unity meshes use 16 bit indexes, so no chunk may exceed 65535 vertexes. Quads are emitted whole, so keep it a multiple of 4.
+    static const size_t s_MaxVertices = 65532;
+    static const size_t s_MaxIndices = (s_MaxVertices / 4) * 6;
+
+    MeshChunk(); // Allocates the full capacity up front so the chunk can be reused without reallocating.
+
+    void Clear();
+
+    bool IsEmpty() const { return m_triangles.empty(); }
+    bool CanFitQuad() const { return (NumVertices() + 4) <= s_MaxVertices; }
+
+    // The corners are wound clockwise when looking at the quad from the side the normal points toward.
+    void AddQuad(const float corners[4][3], const float normal[3]);
+
+    size_t NumVertices() const { return m_vertices.size() / 3; }
+    size_t NumIndices() const { return m_triangles.size(); }
+
+    const float* GetVertices() const { return m_vertices.data(); } // Packed x, y, z.
+    const float* GetNormals() const { return m_normals.data(); } // Packed x, y, z.
+    const int* GetTriangles() const { return m_triangles.data(); }
+
+private:
+    std::vector<float> m_vertices;
+    std::vector<float> m_normals;
+    std::vector<int> m_triangles;
+};
+
+#endif // INCLUDED_MESH_CHUNK_H
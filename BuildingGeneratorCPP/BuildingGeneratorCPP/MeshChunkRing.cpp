@@ -0,0 +1,123 @@
+
+#include "MeshChunkRing.h"
+#include "DebugUtils.h"
+
+MeshChunkRing::MeshChunkRing(size_t numChunks)
+    : m_chunks(numChunks)
+    , m_numSubmitted(0)
+    , m_numAcquired(0)
+    , m_numReleased(0)
+    , m_finished(false)
+    , m_cancelled(false)
+    , m_readyCallback(nullptr)
+    , m_readyCallbackUserData(nullptr)
+    , m_mutex()
+    , m_chunkReleased()
+{
+    dbAssertf(numChunks == 0, "A mesh chunk ring needs at least one chunk.");
+}
+
+void MeshChunkRing::SetReadyCallback(ReadyCallback callback, void* userData)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_readyCallback = callback;
+    m_readyCallbackUserData = userData;
+}
+
+MeshChunk* MeshChunkRing::AcquireEmpty()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // The producer only ever holds one chunk, the one after the last submitted chunk.
+    while (!m_cancelled && (m_numSubmitted - m_numReleased) >= m_chunks.size())
+    {
+        m_chunkReleased.wait(lock);
+    }
+
+    if (m_cancelled)
+    {
+        return nullptr;
+    }
+
+    MeshChunk& chunk = m_chunks[m_numSubmitted % m_chunks.size()];
+    chunk.Clear();
+    return &chunk;
+}
+
+void MeshChunkRing::Submit(MeshChunk* chunk)
+{
+    dbAssertf(chunk != &m_chunks[m_numSubmitted % m_chunks.size()], "Submitted a mesh chunk out of order.");
+
+    ReadyCallback callback;
+    void* userData;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        callback = m_readyCallback;
+        userData = m_readyCallbackUserData;
+    }
+
+    if (callback != nullptr)
+    {
+        // Synchronous hand off: the chunk is consumed before Submit returns, so it goes straight back into the ring.
+        callback(*chunk, userData);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_numSubmitted;
+        ++m_numAcquired;
+        ++m_numReleased;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_numSubmitted;
+}
+
+void MeshChunkRing::Finish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+}
+
+MeshChunk* MeshChunkRing::AcquireReady()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_numAcquired == m_numSubmitted)
+    {
+        return nullptr;
+    }
+
+    MeshChunk& chunk = m_chunks[m_numAcquired % m_chunks.size()];
+    ++m_numAcquired;
+    return &chunk;
+}
+
+bool MeshChunkRing::Release()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_numReleased == m_numAcquired)
+        {
+            dbLogf("Released a mesh chunk that was never acquired.");
+            return false;
+        }
+        ++m_numReleased;
+    }
+    m_chunkReleased.notify_one();
+    return true;
+}
+
+bool MeshChunkRing::IsDrained() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (m_finished || m_cancelled) && m_numReleased == m_numSubmitted;
+}
+
+void MeshChunkRing::Cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+    }
+    m_chunkReleased.notify_all();
+}
@@ -0,0 +1,52 @@
+// A fixed ring of preallocated mesh chunks passed between one producer (the mesher) and one consumer (Unity).
+
+#pragma once
+
+#ifndef INCLUDED_MESH_CHUNK_RING_H
+#define INCLUDED_MESH_CHUNK_RING_H
+
+#include "MeshChunk.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+class MeshChunkRing
+{
+public:
+    // Called on the producer's thread as soon as a chunk is ready. The chunk is recycled once the callback returns.
+    typedef void (*ReadyCallback)(const MeshChunk& chunk, void* userData);
+
+    explicit MeshChunkRing(size_t numChunks);
+
+    void SetReadyCallback(ReadyCallback callback, void* userData);
+
+    // Producer side. AcquireEmpty() blocks while every chunk is waiting on the consumer, and returns nullptr once cancelled.
+    MeshChunk* AcquireEmpty();
+    void Submit(MeshChunk* chunk);
+    void Finish(); // No more chunks will be submitted.
+
+    // Consumer side. AcquireReady() never blocks; it returns nullptr if no chunk is ready yet. Release() returns the oldest acquired chunk to the ring,
+    // or returns false and does nothing if every acquired chunk has already been released.
+    MeshChunk* AcquireReady();
+    bool Release();
+    bool IsDrained() const; // True once the producer has finished and every chunk has been consumed.
+
+    void Cancel(); // Wakes up and stops the producer, e.g. when the consumer goes away early.
+
+private:
+    std::vector<MeshChunk> m_chunks;
+    size_t m_numSubmitted; // Chunks are handed out in ring order, so counters are enough to track which slots are in use.
+    size_t m_numAcquired;
+    size_t m_numReleased;
+    bool m_finished;
+    bool m_cancelled;
+
+    ReadyCallback m_readyCallback;
+    void* m_readyCallbackUserData;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_chunkReleased;
+};
+
+#endif // INCLUDED_MESH_CHUNK_RING_H
@@ -0,0 +1,56 @@
+
+#include "BuildingModules.h"
+
+WindowCutoutExpression CreateWindowCutout(double width, double height, double wallThickness, double recessSize, double recessDepth)
+{
+    CSGBoxExpression opening(
+        Vector4(recessSize, recessSize, 0.0, 1.0),
+        Vector4(recessSize + width, recessSize + height, wallThickness, 1.0));
+    CSGBoxExpression recess(
+        Vector4(0.0, 0.0, 0.0, 1.0),
+        Vector4(width + (2.0 * recessSize), height + (2.0 * recessSize), recessDepth, 1.0));
+
+    return CSGUnion(opening, recess);
+}
+
+DoorFrameExpression CreateDoorFrame(double width, double height, double depth, double frameSize)
+{
+    CSGBoxExpression frame(
+        Vector4(0.0, 0.0, 0.0, 1.0),
+        Vector4(width + (2.0 * frameSize), height + frameSize, depth, 1.0));
+    CSGBoxExpression opening(
+        Vector4(frameSize, 0.0, 0.0, 1.0),
+        Vector4(frameSize + width, height, depth, 1.0));
+
+    return CSGDifference(frame, opening);
+}
+
+FloorSlabExpression CreateFloorSlab(const Vector4& dimensions, const Vector4& stairwellPosition, const Vector4& stairwellDimensions)
+{
+    CSGBoxExpression slab(
+        Vector4(0.0, 0.0, 0.0, 1.0),
+        Vector4(dimensions.x, dimensions.y, dimensions.z, 1.0));
+    CSGBoxExpression stairwell(
+        Vector4(stairwellPosition.x, stairwellPosition.y, stairwellPosition.z, 1.0),
+        Vector4(stairwellPosition.x + stairwellDimensions.x, stairwellPosition.y + stairwellDimensions.y, stairwellPosition.z + stairwellDimensions.z, 1.0));
+
+    return CSGDifference(slab, stairwell);
+}
+
+std::shared_ptr<const CSGModuleBase> CreateBuildingModule(BuildingModuleType type, const double* dimensions, const double* parameters)
+{
+    switch (type)
+    {
+    case BuildingModuleType::WindowCutout:
+        return CreateCSGModule(CreateWindowCutout(dimensions[0], dimensions[1], dimensions[2], parameters[0], parameters[1]));
+    case BuildingModuleType::DoorFrame:
+        return CreateCSGModule(CreateDoorFrame(dimensions[0], dimensions[1], dimensions[2], parameters[0]));
+    case BuildingModuleType::FloorSlab:
+        return CreateCSGModule(CreateFloorSlab(
+            Vector4(dimensions[0], dimensions[1], dimensions[2], 0.0),
+            Vector4(parameters[0], parameters[1], parameters[2], 1.0),
+            Vector4(parameters[3], parameters[4], parameters[5], 0.0)));
+    default:
+        return std::shared_ptr<const CSGModuleBase>();
+    }
+}
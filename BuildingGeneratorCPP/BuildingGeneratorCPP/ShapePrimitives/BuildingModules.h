@@ -0,0 +1,41 @@
+// The standard building modules. Their topologies are fixed here; only their measurements vary.
+
+#pragma once
+
+#ifndef INCLUDED_CSG_BUILDING_MODULES_H
+#define INCLUDED_CSG_BUILDING_MODULES_H
+
+#include "Module.h"
+#include "ModuleExpressions.h"
+
+#include <memory>
+
+enum class BuildingModuleType
+{
+    Invalid = -1,
+    WindowCutout = 0,
+    DoorFrame = 1,
+    FloorSlab = 2,
+};
+
+// The opening through the wall, plus a shallow recess around it on the outside for the frame to sit in.
+typedef CSGUnionExpression<CSGBoxExpression, CSGBoxExpression> WindowCutoutExpression;
+
+// A solid frame around the door opening.
+typedef CSGDifferenceExpression<CSGBoxExpression, CSGBoxExpression> DoorFrameExpression;
+
+// A slab with a rectangular opening for the stairwell.
+typedef CSGDifferenceExpression<CSGBoxExpression, CSGBoxExpression> FloorSlabExpression;
+
+// All modules are anchored at their minimum corner, with x along the wall, y up and z through the wall.
+WindowCutoutExpression CreateWindowCutout(double width, double height, double wallThickness, double recessSize, double recessDepth);
+DoorFrameExpression CreateDoorFrame(double width, double height, double depth, double frameSize);
+FloorSlabExpression CreateFloorSlab(const Vector4& dimensions, const Vector4& stairwellPosition, const Vector4& stairwellDimensions); // Treated as 3D vectors.
+
+// Creates one of the modules above from the measurements in a CSGPrimitiveDesc, or returns null for an unknown type.
+//     WindowCutout: dimensions are width, height and wall thickness. parameters[0] is the recess size and [1] its depth.
+//     DoorFrame: dimensions are width, height and depth. parameters[0] is the frame size.
+//     FloorSlab: dimensions are the slab's. parameters[0] to [2] are the stairwell's position, and [3] to [5] its dimensions.
+std::shared_ptr<const CSGModuleBase> CreateBuildingModule(BuildingModuleType type, const double* dimensions, const double* parameters);
+
+#endif // INCLUDED_CSG_BUILDING_MODULES_H
@@ -0,0 +1,169 @@
+#include "ConvexPiece.h"
+#include "Cuboid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    double Dot(const double* lhs, const double* rhs)
+    {
+        return (lhs[0] * rhs[0]) + (lhs[1] * rhs[1]) + (lhs[2] * rhs[2]);
+    }
+
+    // Column major, so each column of the rotation is a local axis.
+    void TransformDirection(const Matrix4x4& matrix, double x, double y, double z, double* outDirection)
+    {
+        for (size_t i = 0; i < 3; ++i)
+        {
+            outDirection[i] = (matrix[0][i] * x) + (matrix[1][i] * y) + (matrix[2][i] * z);
+        }
+    }
+}
+
+CSGConvexPiece::CSGConvexPiece()
+    : m_numCorners(0)
+{
+}
+
+CSGConvexPiece::CSGConvexPiece(const double* corners, size_t numCorners, double height, const Matrix4x4& localToComposite)
+    : m_numCorners(0)
+{
+    Init(corners, numCorners, height, localToComposite);
+}
+
+CSGConvexPiece::CSGConvexPiece(const CSGCuboid& cuboid)
+    : m_numCorners(0)
+{
+    const Vector4& dimensions = cuboid.GetDimensions();
+    const double corners[s_MaxCorners * 2] = { 0.0, 0.0, dimensions.x, 0.0, dimensions.x, dimensions.z, 0.0, dimensions.z };
+    Init(corners, s_MaxCorners, dimensions.y, cuboid.GetLocalToCompositeMatrix());
+}
+
+void CSGConvexPiece::Init(const double* corners, size_t numCorners, double height, const Matrix4x4& localToComposite)
+{
+    m_numCorners = std::min(numCorners, s_MaxCorners);
+
+    for (size_t c = 0; c < m_numCorners; ++c)
+    {
+        double x = corners[c * 2];
+        double z = corners[(c * 2) + 1];
+        size_t next = (c + 1) % m_numCorners;
+        double sideX = corners[next * 2] - x;
+        double sideZ = corners[(next * 2) + 1] - z;
+
+        TransformDirection(localToComposite, x, 0.0, z, m_vertexes[c * 2]);
+        TransformDirection(localToComposite, x, height, z, m_vertexes[(c * 2) + 1]);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            m_vertexes[c * 2][i] += localToComposite[3][i];
+            m_vertexes[(c * 2) + 1][i] += localToComposite[3][i];
+        }
+
+        TransformDirection(localToComposite, -sideZ, 0.0, sideX, m_faceNormals[c]);
+        TransformDirection(localToComposite, sideX, 0.0, sideZ, m_edgeDirections[c]);
+    }
+
+    TransformDirection(localToComposite, 0.0, 1.0, 0.0, m_faceNormals[m_numCorners]);
+    TransformDirection(localToComposite, 0.0, 1.0, 0.0, m_edgeDirections[m_numCorners]);
+}
+
+bool CSGConvexPiece::Overlaps(const CSGConvexPiece& other) const
+{
+    const CSGConvexPiece* pieces[2] = { this, &other };
+
+    // The candidate axes are the face normals of each piece and the cross products of their edges.
+    double candidates[((s_MaxCorners + 1) * 2) + ((s_MaxCorners + 1) * (s_MaxCorners + 1))][3];
+    size_t numCandidates = 0;
+    for (size_t p = 0; p < 2; ++p)
+    {
+        for (size_t f = 0; f <= pieces[p]->m_numCorners; ++f, ++numCandidates)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                candidates[numCandidates][i] = pieces[p]->m_faceNormals[f][i];
+            }
+        }
+    }
+    for (size_t a = 0; a <= m_numCorners; ++a)
+    {
+        for (size_t b = 0; b <= other.m_numCorners; ++b, ++numCandidates)
+        {
+            const double* u = m_edgeDirections[a];
+            const double* v = other.m_edgeDirections[b];
+            candidates[numCandidates][0] = (u[1] * v[2]) - (u[2] * v[1]);
+            candidates[numCandidates][1] = (u[2] * v[0]) - (u[0] * v[2]);
+            candidates[numCandidates][2] = (u[0] * v[1]) - (u[1] * v[0]);
+        }
+    }
+
+    const double epsilon = 1e-9;
+    for (size_t n = 0; n < numCandidates; ++n)
+    {
+        const double* axis = candidates[n];
+        double lengthSqr = Dot(axis, axis);
+        if (lengthSqr < epsilon)
+        {
+            continue; // Repeated corners and parallel edges give no axis; the face normals already cover that case.
+        }
+
+        double minProjections[2];
+        double maxProjections[2];
+        for (size_t p = 0; p < 2; ++p)
+        {
+            minProjections[p] = maxProjections[p] = Dot(pieces[p]->m_vertexes[0], axis);
+            for (size_t v = 1; v < pieces[p]->m_numCorners * 2; ++v)
+            {
+                double projection = Dot(pieces[p]->m_vertexes[v], axis);
+                minProjections[p] = std::min(minProjections[p], projection);
+                maxProjections[p] = std::max(maxProjections[p], projection);
+            }
+        }
+
+        double tolerance = epsilon * std::sqrt(lengthSqr);
+        if (minProjections[1] > maxProjections[0] + tolerance || minProjections[0] > maxProjections[1] + tolerance)
+        {
+            return false;
+        }
+    }
+    return m_numCorners != 0 && other.m_numCorners != 0;
+}
+
+BoundingBox CSGConvexPiece::CalcBounds() const
+{
+    BoundingBox bounds;
+    for (size_t v = 0; v < m_numCorners * 2; ++v)
+    {
+        bounds.Encapsulate(Vector4(m_vertexes[v][0], m_vertexes[v][1], m_vertexes[v][2], 1.0));
+    }
+    return bounds;
+}
+
+void CSGConvexPiece::Transform(const Matrix4x4& transform)
+{
+    // Rigid, so normals turn just like directions do.
+    for (size_t v = 0; v < m_numCorners * 2; ++v)
+    {
+        const double* vertex = m_vertexes[v];
+        double moved[3];
+        TransformDirection(transform, vertex[0], vertex[1], vertex[2], moved);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            m_vertexes[v][i] = moved[i] + transform[3][i];
+        }
+    }
+    for (size_t f = 0; f <= m_numCorners; ++f)
+    {
+        const double* normal = m_faceNormals[f];
+        const double* direction = m_edgeDirections[f];
+        double turnedNormal[3];
+        double turnedDirection[3];
+        TransformDirection(transform, normal[0], normal[1], normal[2], turnedNormal);
+        TransformDirection(transform, direction[0], direction[1], direction[2], turnedDirection);
+        for (size_t i = 0; i < 3; ++i)
+        {
+            m_faceNormals[f][i] = turnedNormal[i];
+            m_edgeDirections[f][i] = turnedDirection[i];
+        }
+    }
+}
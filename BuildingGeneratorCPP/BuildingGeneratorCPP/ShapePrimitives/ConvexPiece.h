@@ -0,0 +1,43 @@
+// A convex piece of a primitive, in composite space, so primitives that aren't all cuboids can still be tested for overlap exactly.
+
+#pragma once
+
+#ifndef INCLUDED_CSG_CONVEX_PIECE_H
+#define INCLUDED_CSG_CONVEX_PIECE_H
+
+#include "../BoundingBox.h"
+#include "../Matrix4x4.h"
+
+#include <cstddef>
+
+class CSGCuboid;
+
+class CSGConvexPiece
+{
+public:
+    CSGConvexPiece();
+
+    // A convex polygon of up to 4 x, z corners in the local x-z plane, extruded along local y from 0 to height. Corners may repeat, so a
+    // triangle can be given as a quad.
+    CSGConvexPiece(const double* corners, size_t numCorners, double height, const Matrix4x4& localToComposite);
+    explicit CSGConvexPiece(const CSGCuboid& cuboid);
+
+    // Exact separating axis test. Touching pieces count as overlapping, to match Contains().
+    bool Overlaps(const CSGConvexPiece& other) const;
+
+    BoundingBox CalcBounds() const;
+
+    void Transform(const Matrix4x4& transform); // Moves the piece by a rigid transformation of composite space.
+
+private:
+    static const size_t s_MaxCorners = 4;
+
+    void Init(const double* corners, size_t numCorners, double height, const Matrix4x4& localToComposite);
+
+    double m_vertexes[s_MaxCorners * 2][3];
+    double m_faceNormals[s_MaxCorners + 1][3]; // One per side, plus the shared normal of the two caps.
+    double m_edgeDirections[s_MaxCorners + 1][3]; // One per side of the polygon, plus the extrusion.
+    size_t m_numCorners;
+};
+
+#endif // INCLUDED_CSG_CONVEX_PIECE_H
@@ -1,6 +1,8 @@
 
 #include "Cuboid.h"
 
+#include <cmath>
+
 CSGCuboid::CSGCuboid()
     : m_localToCompositeMatrix()
     , m_dimensions()
@@ -26,6 +28,11 @@ CSGCuboid::CSGCuboid(CSGCuboid&& other)
 {
 }
 
+void CSGCuboid::Transform(const Matrix4x4& transform)
+{
+    m_localToCompositeMatrix = transform * m_localToCompositeMatrix;
+}
+
 bool CSGCuboid::Equals(const CSGCuboid& other) const
 {
     Vector4 testPoint = Vector4(1.0, 1.0, 1.0, 1.0);
@@ -38,20 +45,196 @@ bool CSGCuboid::Equals(const CSGCuboid& other) const
 
 bool CSGCuboid::Contains(const Vector4& point) const
 {
-    Vector4 localPoint = m_localToCompositeMatrix.CalcInverseTransform() * point;
-    
-    Vector4 zero = Vector4();
-    if ((localPoint.GreaterThan(zero) || localPoint.Equals(zero))
-        && (localPoint.LessThan(m_dimensions) || localPoint.Equals(m_dimensions)))
+    Vector4 localPoint = m_localToCompositeMatrix.CalcInverseTransform().TransformPoint(point);
+
+    // Only the 3D components matter; w is whatever the caller happened to pass in.
+    return (localPoint.x >= 0.0 && localPoint.x <= m_dimensions.x)
+        && (localPoint.y >= 0.0 && localPoint.y <= m_dimensions.y)
+        && (localPoint.z >= 0.0 && localPoint.z <= m_dimensions.z);
+}
+
+double CSGCuboid::CalcVolume() const
+{
+    return (m_dimensions.x * m_dimensions.y * m_dimensions.z);
+}
+
+BoundingBox CSGCuboid::CalcBounds() const
+{
+    BoundingBox localBounds(Vector4(0.0, 0.0, 0.0, 1.0), Vector4(m_dimensions.x, m_dimensions.y, m_dimensions.z, 1.0));
+    return localBounds.CalcTransformed(m_localToCompositeMatrix);
+}
+
+bool CSGCuboid::TryMerge(const CSGCuboid& other, CSGCuboid& outMerged) const
+{
+    const double epsilon = 1e-6;
+
+    // The rotations must match exactly, otherwise the union isn't a cuboid.
+    for (size_t i = 0; i < 3; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            if (std::abs(m_localToCompositeMatrix[i][j] - other.m_localToCompositeMatrix[i][j]) > epsilon)
+            {
+                return false;
+            }
+        }
+    }
+
+    // Find the other cuboid's anchor in this cuboid's local space. Column major, so each column of the rotation is a local axis.
+    const double* translation = m_localToCompositeMatrix[3];
+    const double* otherTranslation = other.m_localToCompositeMatrix[3];
+    const double delta[3] = { otherTranslation[0] - translation[0], otherTranslation[1] - translation[1], otherTranslation[2] - translation[2] };
+
+    double localOffset[3];
+    for (size_t i = 0; i < 3; ++i)
     {
+        const double* axis = m_localToCompositeMatrix[i];
+        localOffset[i] = (axis[0] * delta[0]) + (axis[1] * delta[1]) + (axis[2] * delta[2]);
+    }
+
+    const double dimensions[3] = { m_dimensions.x, m_dimensions.y, m_dimensions.z };
+    const double otherDimensions[3] = { other.m_dimensions.x, other.m_dimensions.y, other.m_dimensions.z };
+
+    // Exactly one axis may differ, and along it the cuboids must touch end to end.
+    int joinAxis = -1;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (std::abs(localOffset[i]) <= epsilon && std::abs(dimensions[i] - otherDimensions[i]) <= epsilon)
+        {
+            continue;
+        }
+        if (joinAxis != -1)
+        {
+            return false;
+        }
+        joinAxis = i;
+    }
+
+    if (joinAxis == -1)
+    {
+        // The cuboids are identical.
+        outMerged = *this;
         return true;
     }
-    return false;
+
+    bool otherIsAfter = std::abs(localOffset[joinAxis] - dimensions[joinAxis]) <= epsilon;
+    bool otherIsBefore = std::abs(localOffset[joinAxis] + otherDimensions[joinAxis]) <= epsilon;
+    if (!otherIsAfter && !otherIsBefore)
+    {
+        return false;
+    }
+
+    double mergedDimensions[3] = { dimensions[0], dimensions[1], dimensions[2] };
+    mergedDimensions[joinAxis] += otherDimensions[joinAxis];
+
+    outMerged = otherIsAfter ? *this : other;
+    outMerged.SetDimensions(Vector4(mergedDimensions[0], mergedDimensions[1], mergedDimensions[2], m_dimensions.w));
+    return true;
 }
 
-double CSGCuboid::CalcVolume() const
+bool CSGCuboid::Overlaps(const CSGCuboid& other) const
 {
-    return (m_dimensions.x * m_dimensions.y * m_dimensions.z);
+    // Work with centers, unit axes and half extents. Column major, so each column of the rotation is a local axis.
+    const CSGCuboid* cuboids[2] = { this, &other };
+    double axes[2][3][3];
+    double halfExtents[2][3];
+    double centers[2][3];
+
+    for (size_t c = 0; c < 2; ++c)
+    {
+        const Matrix4x4& matrix = cuboids[c]->m_localToCompositeMatrix;
+        const double dimensions[3] = { cuboids[c]->m_dimensions.x, cuboids[c]->m_dimensions.y, cuboids[c]->m_dimensions.z };
+
+        for (size_t i = 0; i < 3; ++i)
+        {
+            centers[c][i] = matrix[3][i];
+        }
+        for (size_t a = 0; a < 3; ++a)
+        {
+            halfExtents[c][a] = dimensions[a] * 0.5;
+            for (size_t i = 0; i < 3; ++i)
+            {
+                axes[c][a][i] = matrix[a][i];
+                centers[c][i] += matrix[a][i] * halfExtents[c][a];
+            }
+        }
+    }
+
+    const double delta[3] = { centers[1][0] - centers[0][0], centers[1][1] - centers[0][1], centers[1][2] - centers[0][2] };
+
+    // The candidate axes are the 3 face normals of each cuboid and the 9 cross products of their edges.
+    double candidates[15][3];
+    size_t numCandidates = 0;
+    for (size_t c = 0; c < 2; ++c)
+    {
+        for (size_t a = 0; a < 3; ++a, ++numCandidates)
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                candidates[numCandidates][i] = axes[c][a][i];
+            }
+        }
+    }
+    for (size_t a = 0; a < 3; ++a)
+    {
+        for (size_t b = 0; b < 3; ++b, ++numCandidates)
+        {
+            const double* u = axes[0][a];
+            const double* v = axes[1][b];
+            candidates[numCandidates][0] = (u[1] * v[2]) - (u[2] * v[1]);
+            candidates[numCandidates][1] = (u[2] * v[0]) - (u[0] * v[2]);
+            candidates[numCandidates][2] = (u[0] * v[1]) - (u[1] * v[0]);
+        }
+    }
+
+    const double epsilon = 1e-9;
+    for (size_t n = 0; n < numCandidates; ++n)
+    {
+        const double* axis = candidates[n];
+        double lengthSqr = (axis[0] * axis[0]) + (axis[1] * axis[1]) + (axis[2] * axis[2]);
+        if (lengthSqr < epsilon)
+        {
+            continue; // Parallel edges give no axis; the face normals already cover that case.
+        }
+
+        double distance = std::abs((delta[0] * axis[0]) + (delta[1] * axis[1]) + (delta[2] * axis[2]));
+
+        double radii = 0.0;
+        for (size_t c = 0; c < 2; ++c)
+        {
+            for (size_t a = 0; a < 3; ++a)
+            {
+                const double* cuboidAxis = axes[c][a];
+                radii += halfExtents[c][a] * std::abs((cuboidAxis[0] * axis[0]) + (cuboidAxis[1] * axis[1]) + (cuboidAxis[2] * axis[2]));
+            }
+        }
+
+        if (distance > radii + (epsilon * std::sqrt(lengthSqr)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CSGCuboid::Contains(const BoundingBox& box) const
+{
+    if (box.IsEmpty())
+    {
+        return true;
+    }
+
+    // The cuboid is convex, so containing every corner means containing the whole box.
+    const Vector4* corners[2] = { &box.minCorner, &box.maxCorner };
+    for (size_t i = 0; i < 8; ++i)
+    {
+        Vector4 corner(corners[i & 1]->x, corners[(i >> 1) & 1]->y, corners[(i >> 2) & 1]->z, 1.0);
+        if (!Contains(corner))
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 void CSGCuboid::operator=(const CSGCuboid& rhs)
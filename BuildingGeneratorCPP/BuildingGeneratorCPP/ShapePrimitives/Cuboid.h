@@ -5,6 +5,7 @@
 #ifndef INCLUDED_CSG_CUBOID_H
 #define INCLUDED_CSG_CUBOID_H
 
+#include "../BoundingBox.h"
 #include "../Matrix4x4.h"
 #include "../Vector4.h"
 
@@ -22,11 +23,23 @@ public:
     bool Contains(const Vector4& point) const;
 
     double CalcVolume() const;
+    BoundingBox CalcBounds() const;
+
+    // Succeeds if the two cuboids share an orientation and a whole face, in which case their union is exactly one cuboid.
+    bool TryMerge(const CSGCuboid& other, CSGCuboid& outMerged) const;
+
+    // Exact separating axis test. Touching cuboids count as overlapping, to match Contains().
+    bool Overlaps(const CSGCuboid& other) const;
+    bool Contains(const BoundingBox& box) const; // Whether the whole box is inside the cuboid.
 
     void operator=(const CSGCuboid& rhs);
 
     void SetPosition(const Vector4& position);
     void SetDimensions(const Vector4& dimensions);
+    void Transform(const Matrix4x4& transform); // Moves the cuboid by a rigid transformation of composite space.
+
+    const Matrix4x4& GetLocalToCompositeMatrix() const { return m_localToCompositeMatrix; }
+    const Vector4& GetDimensions() const { return m_dimensions; }
 
 private:
     Matrix4x4 m_localToCompositeMatrix; // The position of one of the vertexes of the cuboid, called the anchor, in composite space.
@@ -0,0 +1,20 @@
+
+#include "Module.h"
+#include "../Quaternion.h"
+
+CSGModuleInstance::CSGModuleInstance(const std::shared_ptr<const CSGModuleBase>& module, const Vector4& position, const Quaternion& orientation)
+    : m_module(module)
+    , m_compositeToModuleMatrix()
+    , m_bounds()
+{
+    Matrix4x4 moduleToComposite(position, orientation);
+    m_compositeToModuleMatrix = moduleToComposite.CalcInverseTransform();
+    m_bounds = module->CalcBounds().CalcTransformed(moduleToComposite);
+}
+
+void CSGModuleInstance::Transform(const Matrix4x4& transform)
+{
+    Matrix4x4 moduleToComposite = transform * m_compositeToModuleMatrix.CalcInverseTransform();
+    m_compositeToModuleMatrix = moduleToComposite.CalcInverseTransform();
+    m_bounds = m_module->CalcBounds().CalcTransformed(moduleToComposite);
+}
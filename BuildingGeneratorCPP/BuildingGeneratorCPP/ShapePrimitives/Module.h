@@ -0,0 +1,70 @@
+// A reusable CSG module with a fixed topology, such as a window cutout, which can be placed into composites as a leaf.
+
+#pragma once
+
+#ifndef INCLUDED_CSG_MODULE_H
+#define INCLUDED_CSG_MODULE_H
+
+#include "../BoundingBox.h"
+#include "../Matrix4x4.h"
+#include "../Vector4.h"
+
+#include <memory>
+
+class Quaternion;
+
+// Composites only see this interface, so a whole module costs them a single virtual call.
+class CSGModuleBase
+{
+public:
+    virtual ~CSGModuleBase() {}
+
+    virtual bool Contains(const Vector4& point) const = 0; // The point is in module space.
+    virtual BoundingBox CalcBounds() const = 0; // In module space.
+};
+
+// Wraps a module expression (see ModuleExpressions.h), which is evaluated fully inlined.
+template <typename TExpression>
+class CSGModule : public CSGModuleBase
+{
+public:
+    explicit CSGModule(const TExpression& expression)
+        : m_expression(expression)
+    {
+    }
+
+    virtual bool Contains(const Vector4& point) const { return m_expression.Contains(point); }
+    virtual BoundingBox CalcBounds() const { return m_expression.CalcBounds(); }
+
+private:
+    TExpression m_expression;
+};
+
+template <typename TExpression>
+inline std::shared_ptr<const CSGModuleBase> CreateCSGModule(const TExpression& expression)
+{
+    return std::make_shared<CSGModule<TExpression>>(expression);
+}
+
+// One placement of a module in a composite. Modules are shared between all of their placements.
+class CSGModuleInstance
+{
+public:
+    CSGModuleInstance(const std::shared_ptr<const CSGModuleBase>& module, const Vector4& position, const Quaternion& orientation);
+
+    bool Contains(const Vector4& point) const
+    {
+        return m_module->Contains(m_compositeToModuleMatrix.TransformPoint(point));
+    }
+
+    const BoundingBox& GetBounds() const { return m_bounds; } // In composite space.
+
+    void Transform(const Matrix4x4& transform); // Moves the placement by a rigid transformation of composite space.
+
+private:
+    std::shared_ptr<const CSGModuleBase> m_module;
+    Matrix4x4 m_compositeToModuleMatrix; // Cached so that placing a module doesn't add a matrix inverse to every query.
+    BoundingBox m_bounds;
+};
+
+#endif // INCLUDED_CSG_MODULE_H
@@ -0,0 +1,129 @@
+// Expression templates for CSG modules with a fixed topology. The whole tree is a single type, so evaluating it needs no
+// operation switch or shape type dispatch, and the compiler can inline it down to straight line comparisons.
+
+#pragma once
+
+#ifndef INCLUDED_CSG_MODULE_EXPRESSIONS_H
+#define INCLUDED_CSG_MODULE_EXPRESSIONS_H
+
+#include "../BoundingBox.h"
+#include "../Vector4.h"
+
+// The operators use & and | rather than && and || on purpose: evaluating every operand is cheaper than branching on each one.
+
+class CSGBoxExpression
+{
+public:
+    CSGBoxExpression(const Vector4& minCorner, const Vector4& maxCorner)
+        : m_bounds(minCorner, maxCorner)
+    {
+    }
+
+    inline bool Contains(const Vector4& point) const
+    {
+        return (point.x >= m_bounds.minCorner.x) & (point.x <= m_bounds.maxCorner.x)
+            & (point.y >= m_bounds.minCorner.y) & (point.y <= m_bounds.maxCorner.y)
+            & (point.z >= m_bounds.minCorner.z) & (point.z <= m_bounds.maxCorner.z);
+    }
+
+    inline BoundingBox CalcBounds() const { return m_bounds; }
+
+private:
+    BoundingBox m_bounds;
+};
+
+template <typename TLeft, typename TRight>
+class CSGUnionExpression
+{
+public:
+    CSGUnionExpression(const TLeft& left, const TRight& right)
+        : m_left(left)
+        , m_right(right)
+    {
+    }
+
+    inline bool Contains(const Vector4& point) const
+    {
+        return m_left.Contains(point) | m_right.Contains(point);
+    }
+
+    inline BoundingBox CalcBounds() const
+    {
+        BoundingBox bounds = m_left.CalcBounds();
+        bounds.Encapsulate(m_right.CalcBounds());
+        return bounds;
+    }
+
+private:
+    TLeft m_left;
+    TRight m_right;
+};
+
+template <typename TLeft, typename TRight>
+class CSGDifferenceExpression
+{
+public:
+    CSGDifferenceExpression(const TLeft& left, const TRight& right)
+        : m_left(left)
+        , m_right(right)
+    {
+    }
+
+    inline bool Contains(const Vector4& point) const
+    {
+        return m_left.Contains(point) & !m_right.Contains(point);
+    }
+
+    inline BoundingBox CalcBounds() const { return m_left.CalcBounds(); }
+
+private:
+    TLeft m_left;
+    TRight m_right;
+};
+
+template <typename TLeft, typename TRight>
+class CSGIntersectionExpression
+{
+public:
+    CSGIntersectionExpression(const TLeft& left, const TRight& right)
+        : m_left(left)
+        , m_right(right)
+    {
+    }
+
+    inline bool Contains(const Vector4& point) const
+    {
+        return m_left.Contains(point) & m_right.Contains(point);
+    }
+
+    inline BoundingBox CalcBounds() const
+    {
+        return m_left.CalcBounds().CalcIntersection(m_right.CalcBounds());
+    }
+
+private:
+    TLeft m_left;
+    TRight m_right;
+};
+
+// Helpers so that module trees can be written out without spelling their types twice.
+
+template <typename TLeft, typename TRight>
+inline CSGUnionExpression<TLeft, TRight> CSGUnion(const TLeft& left, const TRight& right)
+{
+    return CSGUnionExpression<TLeft, TRight>(left, right);
+}
+
+template <typename TLeft, typename TRight>
+inline CSGDifferenceExpression<TLeft, TRight> CSGDifference(const TLeft& left, const TRight& right)
+{
+    return CSGDifferenceExpression<TLeft, TRight>(left, right);
+}
+
+template <typename TLeft, typename TRight>
+inline CSGIntersectionExpression<TLeft, TRight> CSGIntersection(const TLeft& left, const TRight& right)
+{
+    return CSGIntersectionExpression<TLeft, TRight>(left, right);
+}
+
+#endif // INCLUDED_CSG_MODULE_EXPRESSIONS_H
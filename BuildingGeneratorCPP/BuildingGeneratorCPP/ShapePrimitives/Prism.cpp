@@ -0,0 +1,412 @@
+
+#include "Prism.h"
+#include "Cuboid.h"
+#include "../DebugUtils.h"
+#include "../Quaternion.h"
+
+#include <algorithm>
+#include <cmath>
+
+CSGPrism::CSGPrism(const double* points, size_t numPoints, double height, const Vector4& position, const Quaternion& orientation)
+    : CSGPrism(points, numPoints, height, position, orientation, GetDefaultMemoryResource())
+{
+}
+
+CSGPrism::CSGPrism(const double* points, size_t numPoints, double height, const Vector4& position, const Quaternion& orientation,
+    MemoryResource* resource)
+    : m_edges(resource)
+    , m_pieces(resource)
+    , m_pieceBounds(resource)
+    , m_fillWinding(0)
+    , m_compositeToLocalMatrix()
+    , m_localToCompositeMatrix(position, orientation)
+    , m_height(height)
+    , m_minX(0.0)
+    , m_maxX(0.0)
+    , m_minZ(0.0)
+    , m_maxZ(0.0)
+{
+    m_compositeToLocalMatrix = m_localToCompositeMatrix.CalcInverseTransform();
+
+    if (numPoints == 0)
+    {
+        return;
+    }
+
+    m_edges.reserve(numPoints); // Each point starts at most one edge, so the table is only allocated once.
+
+    m_minX = m_maxX = points[0];
+    m_minZ = m_maxZ = points[1];
+
+    size_t ringStart = 0;
+    for (size_t i = 0; i < numPoints; ++i)
+    {
+        double x = points[i * 2];
+        double z = points[(i * 2) + 1];
+        m_minX = std::min(m_minX, x);
+        m_maxX = std::max(m_maxX, x);
+        m_minZ = std::min(m_minZ, z);
+        m_maxZ = std::max(m_maxZ, z);
+
+        if (i > ringStart)
+        {
+            AddEdge(points[(i - 1) * 2], points[((i - 1) * 2) + 1], x, z);
+        }
+
+        bool returnsToStart = (i > ringStart) && (x == points[ringStart * 2]) && (z == points[(ringStart * 2) + 1]);
+        if (returnsToStart || (i + 1) == numPoints)
+        {
+            if (!returnsToStart)
+            {
+                AddEdge(x, z, points[ringStart * 2], points[(ringStart * 2) + 1]);
+            }
+            ringStart = i + 1;
+        }
+    }
+
+    std::sort(m_edges.begin(), m_edges.end(), [](const Edge& lhs, const Edge& rhs) { return lhs.minZ < rhs.minZ; });
+    CalcConvexPieces();
+}
+
+CSGPrism::CSGPrism(const CSGPrism& other, MemoryResource* resource)
+    : m_edges(other.m_edges.begin(), other.m_edges.end(), resource)
+    , m_pieces(other.m_pieces.begin(), other.m_pieces.end(), resource)
+    , m_pieceBounds(other.m_pieceBounds.begin(), other.m_pieceBounds.end(), resource)
+    , m_fillWinding(other.m_fillWinding)
+    , m_compositeToLocalMatrix(other.m_compositeToLocalMatrix)
+    , m_localToCompositeMatrix(other.m_localToCompositeMatrix)
+    , m_height(other.m_height)
+    , m_minX(other.m_minX)
+    , m_maxX(other.m_maxX)
+    , m_minZ(other.m_minZ)
+    , m_maxZ(other.m_maxZ)
+{
+}
+
+CSGPrism::CSGPrism(const CSGPrism* const* prisms, size_t numPrisms, MemoryResource* resource)
+    : CSGPrism(*prisms[0], resource)
+{
+    if (numPrisms == 1)
+    {
+        return;
+    }
+
+    size_t numEdges = 0;
+    for (size_t i = 0; i < numPrisms; ++i)
+    {
+        numEdges += prisms[i]->m_edges.size();
+    }
+    m_edges.reserve(numEdges);
+
+    for (size_t i = 1; i < numPrisms; ++i)
+    {
+        const CSGPrism& other = *prisms[i];
+        dbAssertf(!CanMerge(other), "Merging prisms that don't share a frame, a height and a winding.");
+
+        // Filled regions winding opposite ways would cancel out where they overlap.
+        const int flip = (other.m_fillWinding == m_fillWinding) ? 1 : -1;
+        for (const Edge& otherEdge : other.m_edges)
+        {
+            Edge edge = otherEdge;
+            edge.winding *= flip;
+            m_edges.push_back(edge);
+        }
+
+        m_minX = std::min(m_minX, other.m_minX);
+        m_maxX = std::max(m_maxX, other.m_maxX);
+        m_minZ = std::min(m_minZ, other.m_minZ);
+        m_maxZ = std::max(m_maxZ, other.m_maxZ);
+    }
+
+    std::sort(m_edges.begin(), m_edges.end(), [](const Edge& lhs, const Edge& rhs) { return lhs.minZ < rhs.minZ; });
+    CalcConvexPieces();
+}
+
+bool CSGPrism::Contains(const Vector4& point) const
+{
+    Vector4 localPoint = m_compositeToLocalMatrix.TransformPoint(point);
+
+    if (localPoint.y < 0.0 || localPoint.y > m_height
+        || localPoint.x < m_minX || localPoint.x > m_maxX
+        || localPoint.z < m_minZ || localPoint.z > m_maxZ)
+    {
+        return false;
+    }
+
+    // Sum the windings of the edges crossed by a ray from the point towards +x. An edge covering [minZ, maxZ) and crossed only
+    // strictly to the right of the point finds the inside of the polygon without its top and right sides. Also covering
+    // (minZ, maxZ], and crossing edges that pass through the point, adds those sides back, so the polygon is closed like y is.
+    // The windings are indexed by whether edges cover their top rather than their bottom, then by whether edges through the
+    // point count.
+    int windings[2][2] = { { 0, 0 }, { 0, 0 } };
+    for (const Edge& edge : m_edges)
+    {
+        if (edge.minZ > localPoint.z)
+        {
+            break;
+        }
+        if (localPoint.z > edge.maxZ)
+        {
+            continue;
+        }
+
+        double edgeX = edge.xAtMinZ + ((localPoint.z - edge.minZ) * edge.xPerZ);
+        if (localPoint.x > edgeX)
+        {
+            continue;
+        }
+        const bool coversBottom = localPoint.z < edge.maxZ;
+        const bool coversTop = localPoint.z > edge.minZ;
+        const bool isRightOf = localPoint.x < edgeX;
+        windings[0][0] += (coversBottom && isRightOf) ? edge.winding : 0;
+        windings[0][1] += coversBottom ? edge.winding : 0;
+        windings[1][0] += (coversTop && isRightOf) ? edge.winding : 0;
+        windings[1][1] += coversTop ? edge.winding : 0;
+    }
+    return windings[0][0] != 0 || windings[0][1] != 0 || windings[1][0] != 0 || windings[1][1] != 0;
+}
+
+BoundingBox CSGPrism::CalcBounds() const
+{
+    if (m_edges.empty())
+    {
+        return BoundingBox();
+    }
+
+    BoundingBox localBounds(Vector4(m_minX, 0.0, m_minZ, 1.0), Vector4(m_maxX, m_height, m_maxZ, 1.0));
+    return localBounds.CalcTransformed(m_localToCompositeMatrix);
+}
+
+bool CSGPrism::Overlaps(const CSGCuboid& cuboid) const
+{
+    if (!CalcBounds().Overlaps(cuboid.CalcBounds()))
+    {
+        return false;
+    }
+
+    CSGConvexPiece cuboidPiece(cuboid);
+    BoundingBox cuboidBounds = cuboid.CalcBounds();
+    for (size_t i = 0; i < m_pieces.size(); ++i)
+    {
+        if (m_pieceBounds[i].Overlaps(cuboidBounds) && m_pieces[i].Overlaps(cuboidPiece))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CSGPrism::Overlaps(const CSGPrism& other) const
+{
+    if (!CalcBounds().Overlaps(other.CalcBounds()))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_pieces.size(); ++i)
+    {
+        for (size_t j = 0; j < other.m_pieces.size(); ++j)
+        {
+            if (m_pieceBounds[i].Overlaps(other.m_pieceBounds[j]) && m_pieces[i].Overlaps(other.m_pieces[j]))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+double CSGPrism::CalcVolume() const
+{
+    std::vector<Trapezoid> trapezoids;
+    CalcTrapezoids(trapezoids);
+
+    double area = 0.0;
+    for (const Trapezoid& trapezoid : trapezoids)
+    {
+        double startWidth = trapezoid.startMaxX - trapezoid.startMinX;
+        double endWidth = trapezoid.endMaxX - trapezoid.endMinX;
+        area += (startWidth + endWidth) * 0.5 * (trapezoid.endZ - trapezoid.startZ);
+    }
+    return area * m_height;
+}
+
+void CSGPrism::CalcConvexPieces()
+{
+    std::vector<Trapezoid> trapezoids;
+    CalcTrapezoids(trapezoids);
+
+    m_pieces.clear();
+    m_pieceBounds.clear();
+    m_pieces.reserve(trapezoids.size());
+    m_pieceBounds.reserve(trapezoids.size());
+    m_fillWinding = trapezoids.empty() ? 0 : trapezoids[0].winding;
+    for (const Trapezoid& trapezoid : trapezoids)
+    {
+        m_fillWinding = (trapezoid.winding == m_fillWinding) ? m_fillWinding : 0;
+
+        const double corners[8] =
+        {
+            trapezoid.startMinX, trapezoid.startZ,
+            trapezoid.startMaxX, trapezoid.startZ,
+            trapezoid.endMaxX, trapezoid.endZ,
+            trapezoid.endMinX, trapezoid.endZ,
+        };
+        m_pieces.push_back(CSGConvexPiece(corners, 4, m_height, m_localToCompositeMatrix));
+        m_pieceBounds.push_back(m_pieces.back().CalcBounds());
+    }
+}
+
+void CSGPrism::CalcTrapezoids(std::vector<Trapezoid>& outTrapezoids) const
+{
+    outTrapezoids.clear();
+
+    // Between consecutive cuts no edge starts, ends or crosses another, so the edges spanning a slab keep their order across it.
+    std::vector<double> cuts;
+    cuts.reserve(m_edges.size() * 2);
+    for (size_t i = 0; i < m_edges.size(); ++i)
+    {
+        const Edge& edge = m_edges[i];
+        cuts.push_back(edge.minZ);
+        cuts.push_back(edge.maxZ);
+
+        for (size_t j = i + 1; j < m_edges.size() && m_edges[j].minZ < edge.maxZ; ++j)
+        {
+            const Edge& otherEdge = m_edges[j];
+            double slopeDifference = edge.xPerZ - otherEdge.xPerZ;
+            if (slopeDifference == 0.0)
+            {
+                continue;
+            }
+
+            // Both edges cover otherEdge.minZ, since the edges are sorted by minZ.
+            double gap = (otherEdge.xAtMinZ - edge.xAtMinZ) - ((otherEdge.minZ - edge.minZ) * edge.xPerZ);
+            double crossingZ = otherEdge.minZ + (gap / slopeDifference);
+            if (crossingZ > otherEdge.minZ && crossingZ < std::min(edge.maxZ, otherEdge.maxZ))
+            {
+                cuts.push_back(crossingZ);
+            }
+        }
+    }
+    std::sort(cuts.begin(), cuts.end());
+    cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+    std::vector<std::pair<double, const Edge*>> spanning;
+    for (size_t c = 0; c + 1 < cuts.size(); ++c)
+    {
+        double startZ = cuts[c];
+        double endZ = cuts[c + 1];
+        double middleZ = (startZ + endZ) * 0.5;
+
+        spanning.clear();
+        for (const Edge& edge : m_edges)
+        {
+            if (edge.minZ > startZ)
+            {
+                break;
+            }
+            if (edge.maxZ >= endZ)
+            {
+                spanning.push_back(std::make_pair(edge.xAtMinZ + ((middleZ - edge.minZ) * edge.xPerZ), &edge));
+            }
+        }
+        std::sort(spanning.begin(), spanning.end());
+
+        // By the nonzero winding rule, the polygon is inside from where the windings of the edges crossed so far stop summing
+        // to zero until where they return to it. Edges in between only overlap the polygon with itself.
+        int winding = 0;
+        const Edge* left = nullptr;
+        for (const std::pair<double, const Edge*>& crossing : spanning)
+        {
+            const Edge& edge = *crossing.second;
+            if (winding == 0)
+            {
+                left = &edge;
+            }
+            winding += edge.winding;
+            if (winding != 0)
+            {
+                continue;
+            }
+
+            const Edge& right = edge;
+            Trapezoid trapezoid;
+            trapezoid.startZ = startZ;
+            trapezoid.endZ = endZ;
+            trapezoid.startMinX = left->xAtMinZ + ((startZ - left->minZ) * left->xPerZ);
+            trapezoid.startMaxX = right.xAtMinZ + ((startZ - right.minZ) * right.xPerZ);
+            trapezoid.endMinX = left->xAtMinZ + ((endZ - left->minZ) * left->xPerZ);
+            trapezoid.endMaxX = right.xAtMinZ + ((endZ - right.minZ) * right.xPerZ);
+            trapezoid.winding = left->winding;
+            outTrapezoids.push_back(trapezoid);
+        }
+    }
+}
+
+bool CSGPrism::CanMerge(const CSGPrism& other) const
+{
+    const double epsilon = 1e-6;
+
+    if (m_fillWinding == 0 || other.m_fillWinding == 0 || std::abs(m_height - other.m_height) > epsilon)
+    {
+        return false;
+    }
+
+    // The whole frame must match, translation included, since the rings are only meaningful in their own prism's local space.
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            if (std::abs(m_localToCompositeMatrix[i][j] - other.m_localToCompositeMatrix[i][j]) > epsilon)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void CSGPrism::Transform(const Matrix4x4& transform)
+{
+    m_localToCompositeMatrix = transform * m_localToCompositeMatrix;
+    m_compositeToLocalMatrix = m_localToCompositeMatrix.CalcInverseTransform();
+
+    // The pieces are only moved, so there is no need to split the polygon again.
+    for (size_t i = 0; i < m_pieces.size(); ++i)
+    {
+        m_pieces[i].Transform(transform);
+        m_pieceBounds[i] = m_pieces[i].CalcBounds();
+    }
+}
+
+size_t CSGPrism::CalcMemoryUsage() const
+{
+    return (m_edges.capacity() * sizeof(Edge)) + (m_pieces.capacity() * sizeof(CSGConvexPiece))
+        + (m_pieceBounds.capacity() * sizeof(BoundingBox));
+}
+
+void CSGPrism::AddEdge(double startX, double startZ, double endX, double endZ)
+{
+    if (startZ == endZ)
+    {
+        return; // Parallel to the ray, so it can never be crossed.
+    }
+
+    Edge edge;
+    if (startZ < endZ)
+    {
+        edge.minZ = startZ;
+        edge.maxZ = endZ;
+        edge.xAtMinZ = startX;
+        edge.winding = 1;
+    }
+    else
+    {
+        edge.minZ = endZ;
+        edge.maxZ = startZ;
+        edge.xAtMinZ = endX;
+        edge.winding = -1;
+    }
+    edge.xPerZ = (endX - startX) / (endZ - startZ);
+    m_edges.push_back(edge);
+}
@@ -0,0 +1,95 @@
+// A CSG prism: a 2D polygon in the local x-z plane, extruded along local y.
+
+#pragma once
+
+#ifndef INCLUDED_CSG_PRISM_H
+#define INCLUDED_CSG_PRISM_H
+
+#include "../BoundingBox.h"
+#include "../Matrix4x4.h"
+#include "../MemoryResource.h"
+#include "../Vector4.h"
+#include "ConvexPiece.h"
+
+#include <vector>
+
+class CSGCuboid;
+class Quaternion;
+
+class CSGPrism
+{
+public:
+    // Points are x, z pairs forming one or more closed rings. A ring ends when it returns to its first point, and the last ring
+    // is closed automatically. Rings combine with the nonzero winding rule: a ring inside another one is a hole if it winds the
+    // other way, and a ring that crosses itself stays filled where it overlaps.
+    CSGPrism(const double* points, size_t numPoints, double height, const Vector4& position, const Quaternion& orientation);
+    CSGPrism(const double* points, size_t numPoints, double height, const Vector4& position, const Quaternion& orientation,
+        MemoryResource* resource); // The edge table and convex pieces come from the resource, which must outlive the prism.
+    CSGPrism(const CSGPrism& other, MemoryResource* resource); // Copies the edge table and convex pieces into the resource.
+
+    // The union of prisms that can all merge with the first, as one prism of all of their rings.
+    CSGPrism(const CSGPrism* const* prisms, size_t numPrisms, MemoryResource* resource);
+
+    bool Contains(const Vector4& point) const; // Points on the surface count as inside.
+
+    double CalcVolume() const; // Exact: the area inside the rings, by the nonzero winding rule, times the height.
+    BoundingBox CalcBounds() const; // In composite space.
+
+    // Exact, by testing the convex pieces of the prism with separating axes. Touching counts as overlapping, to match Contains().
+    bool Overlaps(const CSGCuboid& cuboid) const;
+    bool Overlaps(const CSGPrism& other) const;
+
+    // Succeeds if the two prisms share a position, orientation and height, and each winds the same way everywhere it is filled.
+    // Their rings together then fill exactly their union, once the other prism's are turned round to wind the same way.
+    bool CanMerge(const CSGPrism& other) const;
+
+    void Transform(const Matrix4x4& transform); // Moves the prism by a rigid transformation of composite space.
+
+    size_t CalcMemoryUsage() const; // The bytes held by the edge table and convex pieces.
+    size_t NumEdges() const { return m_edges.size(); }
+
+private:
+    // One polygon edge, stored so that a scanline at any z finds its crossing with a single multiply.
+    struct Edge
+    {
+        double minZ;
+        double maxZ;
+        double xAtMinZ;
+        double xPerZ;
+        int winding; // 1 if the ring runs towards +z along the edge, -1 if towards -z.
+    };
+
+    // The part of the polygon between two z values, bounded by one pair of edges that don't cross in between.
+    struct Trapezoid
+    {
+        double startZ;
+        double endZ;
+        double startMinX;
+        double startMaxX;
+        double endMinX;
+        double endMaxX;
+        int winding; // The sign of the winding inside, which can only change by passing through zero at an edge.
+    };
+
+    void AddEdge(double startX, double startZ, double endX, double endZ);
+
+    // Splits the polygon into trapezoids between the z values where edges start, end or cross.
+    void CalcTrapezoids(std::vector<Trapezoid>& outTrapezoids) const;
+
+    // Extrudes each trapezoid into a convex piece in composite space, for the overlap tests.
+    void CalcConvexPieces();
+
+    ResourceVector<Edge> m_edges; // Sorted by minZ, so a scan can stop at the first edge that starts above the point.
+    ResourceVector<CSGConvexPiece> m_pieces; // Splitting the polygon is quadratic in its edges, so it is only done once.
+    ResourceVector<BoundingBox> m_pieceBounds;
+    int m_fillWinding; // The sign of the winding wherever the prism is filled, or 0 if it winds both ways or is empty.
+    Matrix4x4 m_compositeToLocalMatrix;
+    Matrix4x4 m_localToCompositeMatrix;
+    double m_height;
+    double m_minX; // The polygon's 2D bounds, to reject most points before looking at any edges.
+    double m_maxX;
+    double m_minZ;
+    double m_maxZ;
+};
+
+#endif // INCLUDED_CSG_PRISM_H
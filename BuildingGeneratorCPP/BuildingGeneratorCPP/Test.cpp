@@ -1,8 +1,332 @@
 // An entry point to test the shape compositing. This will likely be superceded by making this a Unity plugin.
 
+#include "BlueprintBaker.h"
+#include "BuildingLevelBuilder.h"
 #include "CompositeShape.h"
+#include "MemoryResource.h"
+#include "Quaternion.h"
+#include "ShapePrimitives/BuildingModules.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    // Samples sit halfway between multiples of s_SampleSpacing, and every measurement below is such a multiple, so no sample
+    // lands on a face where rounding could make the two sides disagree.
+    const double s_SampleSpacing = 1.0 / 16.0;
+
+    CSGPrimitiveDesc CreateModuleDesc(BuildingModuleType type, const Vector4& position, const Quaternion& orientation,
+        const double* dimensions, const double* parameters, size_t numParameters)
+    {
+        CSGPrimitiveDesc primitive = {};
+        primitive.position[0] = position.x;
+        primitive.position[1] = position.y;
+        primitive.position[2] = position.z;
+        primitive.orientation[0] = orientation.a;
+        primitive.orientation[1] = orientation.b;
+        primitive.orientation[2] = orientation.c;
+        primitive.orientation[3] = orientation.d;
+        for (size_t i = 0; i < 3; ++i)
+        {
+            primitive.dimensions[i] = dimensions[i];
+        }
+        for (size_t i = 0; i < numParameters; ++i)
+        {
+            primitive.moduleParameters[i] = parameters[i];
+        }
+        primitive.shapeType = static_cast<int>(CSGShapes::Module);
+        primitive.moduleType = static_cast<int>(type);
+        return primitive;
+    }
+
+    bool BuildModule(const CSGPrimitiveDesc& primitive, CompositeShape& outComposite)
+    {
+        const int operation = static_cast<int>(ShapeOperations::Shape);
+
+        CompositeShapeDesc desc = {};
+        desc.primitives = &primitive;
+        desc.numPrimitives = 1;
+        desc.operations = &operation;
+        desc.numOperations = 1;
+        return outComposite.Build(desc, nullptr, 0);
+    }
+
+    // Combines a box given in module space, placed the same way as the module, with the runtime tree.
+    void CombineBox(CompositeShape& tree, ShapeOperations operation, const Vector4& position, const Quaternion& orientation,
+        const Vector4& minCorner, const Vector4& maxCorner)
+    {
+        Matrix4x4 moduleToComposite(position, orientation);
+        CSGCuboid box(moduleToComposite.TransformPoint(minCorner), maxCorner - minCorner, orientation);
+        if (operation == ShapeOperations::Union)
+        {
+            tree.Union(box);
+        }
+        else
+        {
+            tree.Difference(box);
+        }
+    }
+
+    // Compares the two composites over a grid spanning the first one's bounds, plus a margin. Returns the number of samples they disagree on.
+    int CountMismatches(const char* name, const CompositeShape& reference, const CompositeShape& tree)
+    {
+        BoundingBox bounds = reference.CalcBounds();
+        int mismatches = 0;
+        int samples = 0;
+        for (double x = std::floor(bounds.minCorner.x) - 0.5 + (s_SampleSpacing * 0.5); x < bounds.maxCorner.x + 0.5; x += s_SampleSpacing)
+        {
+            for (double y = std::floor(bounds.minCorner.y) - 0.5 + (s_SampleSpacing * 0.5); y < bounds.maxCorner.y + 0.5; y += s_SampleSpacing)
+            {
+                for (double z = std::floor(bounds.minCorner.z) - 0.5 + (s_SampleSpacing * 0.5); z < bounds.maxCorner.z + 0.5; z += s_SampleSpacing)
+                {
+                    Vector4 point(x, y, z, 1.0);
+                    mismatches += (reference.Contains(point) != tree.Contains(point)) ? 1 : 0;
+                    ++samples;
+                }
+            }
+        }
+
+        std::printf("%s: %d of %d samples differ from the reference.\n", name, mismatches, samples);
+        return mismatches;
+    }
+
+    // Builds each standard module from a description, and checks it against the same boxes combined as a runtime composite.
+    int TestBuildingModules(const Vector4& position, const Quaternion& orientation)
+    {
+        int mismatches = 0;
+
+        {
+            const double dimensions[3] = { 1.25, 1.5, 0.5 };
+            const double parameters[2] = { 0.125, 0.25 };
+            CompositeShape module;
+            BuildModule(CreateModuleDesc(BuildingModuleType::WindowCutout, position, orientation, dimensions, parameters, 2), module);
+
+            CompositeShape tree;
+            CombineBox(tree, ShapeOperations::Union, position, orientation, Vector4(0.125, 0.125, 0.0, 1.0), Vector4(1.375, 1.625, 0.5, 1.0));
+            CombineBox(tree, ShapeOperations::Union, position, orientation, Vector4(0.0, 0.0, 0.0, 1.0), Vector4(1.5, 1.75, 0.25, 1.0));
+            mismatches += CountMismatches("Window cutout", module, tree);
+        }
+
+        {
+            const double dimensions[3] = { 1.0, 2.0, 0.25 };
+            const double parameters[1] = { 0.125 };
+            CompositeShape module;
+            BuildModule(CreateModuleDesc(BuildingModuleType::DoorFrame, position, orientation, dimensions, parameters, 1), module);
+
+            CompositeShape tree;
+            CombineBox(tree, ShapeOperations::Union, position, orientation, Vector4(0.0, 0.0, 0.0, 1.0), Vector4(1.25, 2.125, 0.25, 1.0));
+            CombineBox(tree, ShapeOperations::Difference, position, orientation, Vector4(0.125, 0.0, 0.0, 1.0), Vector4(1.125, 2.0, 0.25, 1.0));
+            mismatches += CountMismatches("Door frame", module, tree);
+        }
+
+        {
+            const double dimensions[3] = { 4.0, 0.25, 3.0 };
+            const double parameters[6] = { 1.0, 0.0, 0.5, 1.5, 0.25, 1.0 };
+            CompositeShape module;
+            BuildModule(CreateModuleDesc(BuildingModuleType::FloorSlab, position, orientation, dimensions, parameters, 6), module);
+
+            CompositeShape tree;
+            CombineBox(tree, ShapeOperations::Union, position, orientation, Vector4(0.0, 0.0, 0.0, 1.0), Vector4(4.0, 0.25, 3.0, 1.0));
+            CombineBox(tree, ShapeOperations::Difference, position, orientation, Vector4(1.0, 0.0, 0.5, 1.0), Vector4(2.5, 0.25, 1.5, 1.0));
+            mismatches += CountMismatches("Floor slab", module, tree);
+        }
+
+        return mismatches;
+    }
+
+    // Checks prism overlaps against shapes whose bounds overlap the prism's but whose volumes don't. Returns the number of wrong answers.
+    int TestPrismOverlaps()
+    {
+        const double lShape[12] = { 0.0, 0.0, 4.0, 0.0, 4.0, 1.0, 1.0, 1.0, 1.0, 4.0, 0.0, 4.0 };
+        const double squareWithHole[18] = { 0.0, 0.0, 4.0, 0.0, 4.0, 4.0, 0.0, 4.0, 0.0, 0.0, 1.0, 1.0, 1.0, 3.0, 3.0, 3.0, 3.0, 1.0 }; // The hole winds the other way.
+        const double triangle[6] = { 1.25, 1.25, 2.75, 1.25, 2.0, 2.75 };
+        const Vector4 origin(0.0, 0.0, 0.0, 1.0);
+
+        CSGPrism lPrism(lShape, 6, 1.0, origin, Quaternion());
+        CSGPrism holedPrism(squareWithHole, 9, 1.0, origin, Quaternion());
+        CSGPrism trianglePrism(triangle, 3, 1.0, origin, Quaternion());
+
+        int failures = 0;
+        failures += lPrism.Overlaps(CSGCuboid(Vector4(2.0, 0.0, 2.0, 1.0), Vector4(1.0, 1.0, 1.0, 0.0), Quaternion())) ? 1 : 0;
+        failures += lPrism.Overlaps(CSGCuboid(Vector4(0.5, 0.0, 2.0, 1.0), Vector4(1.0, 1.0, 1.0, 0.0), Quaternion())) ? 0 : 1;
+        failures += lPrism.Overlaps(CSGCuboid(Vector4(1.0, 0.0, 1.0, 1.0), Vector4(1.0, 1.0, 1.0, 0.0), Quaternion())) ? 0 : 1; // Touching.
+        failures += holedPrism.Overlaps(CSGCuboid(Vector4(1.5, 0.25, 1.5, 1.0), Vector4(1.0, 0.5, 1.0, 0.0), Quaternion())) ? 1 : 0;
+        failures += holedPrism.Overlaps(trianglePrism) ? 1 : 0;
+        failures += lPrism.Overlaps(trianglePrism) ? 1 : 0;
+
+        std::printf("Prism overlaps: %d wrong answers.\n", failures);
+        return failures;
+    }
+
+    // Builds a level of several walls and a floor, and checks that every coarser level of detail has fewer primitives but still
+    // the same shape. Returns the number of wrong answers, plus the number of samples that differ.
+    int TestLevelSimplification()
+    {
+        const int wallPoints[10] = { 0, 0, 4, 0, 4, 3, 0, 0, 0, 3 }; // An L-shaped wall, then a straight one meeting its end.
+        const int wallPointCounts[2] = { 3, 2 };
+        const int floorPoints[8] = { 0, 0, 4, 0, 4, 3, 0, 3 };
+        const int floorPointCounts[1] = { 4 };
+
+        BuildingLevelDesc level = {};
+        level.wallHeight = 2.0;
+        level.wallThickness = 0.25;
+        level.floorThickness = 0.125;
+        level.wallPoints = wallPoints;
+        level.wallPointCounts = wallPointCounts;
+        level.numWalls = 2;
+        level.floorPoints = floorPoints;
+        level.floorPointCounts = floorPointCounts;
+        level.numFloors = 1;
+
+        std::vector<CSGPrimitiveDesc> primitives;
+        std::vector<int> operations;
+        std::vector<double> points;
+        DescribeBuildingLevel(level, primitives, operations, points);
+
+        CompositeShapeDesc desc = {};
+        desc.primitives = primitives.data();
+        desc.numPrimitives = primitives.size();
+        desc.operations = operations.data();
+        desc.numOperations = operations.size();
+        desc.points = points.data();
+        desc.numPoints = points.size() / 2;
+
+        CompositeShape composite;
+        if (!composite.Build(desc, nullptr, 0))
+        {
+            std::printf("Level simplification: the level couldn't be built.\n");
+            return 1;
+        }
+
+        // As CompositeLODChain simplifies levels 1 to 3, starting from a voxel the size of the sample spacing.
+        int failures = 0;
+        for (int lod = 1; lod <= 3; ++lod)
+        {
+            CompositeShape simplified = composite.CreateSimplified(s_SampleSpacing * (1 << lod) * 2.0);
+            failures += (simplified.NumPrimitives() < composite.NumPrimitives()) ? 0 : 1;
+            failures += CountMismatches("Simplified level", composite, simplified);
+        }
+
+        std::printf("Level simplification: %d wrong answers.\n", failures);
+        return failures;
+    }
+
+    // Checks that prisms are closed, and that a ring which overlaps itself stays filled. Returns the number of wrong answers.
+    int TestPrismContains()
+    {
+        const double lShape[12] = { 0.0, 0.0, 4.0, 0.0, 4.0, 1.0, 1.0, 1.0, 1.0, 4.0, 0.0, 4.0 };
+        const double folded[16] = { 0.0, 0.0, 3.0, 0.0, 3.0, 2.0, 1.0, 2.0, 1.0, 1.0, 2.0, 1.0, 2.0, 3.0, 0.0, 3.0 }; // Overlaps itself over 1 to 2.
+        const Vector4 origin(0.0, 0.0, 0.0, 1.0);
+
+        CSGPrism lPrism(lShape, 6, 1.0, origin, Quaternion());
+        CSGPrism foldedPrism(folded, 8, 1.0, origin, Quaternion());
+
+        int failures = 0;
+        failures += lPrism.Contains(Vector4(0.5, 0.5, 4.0, 1.0)) ? 0 : 1; // On the far side in z.
+        failures += lPrism.Contains(Vector4(4.0, 1.0, 1.0, 1.0)) ? 0 : 1; // On the far corner, at the top.
+        failures += lPrism.Contains(Vector4(1.0, 0.5, 2.5, 1.0)) ? 0 : 1; // On the inside corner's side.
+        failures += lPrism.Contains(Vector4(2.0, 0.5, 2.0, 1.0)) ? 1 : 0;
+        failures += foldedPrism.Contains(Vector4(1.5, 0.5, 1.5, 1.0)) ? 0 : 1;
+        failures += (std::abs(foldedPrism.CalcVolume() - 8.0) < 1e-9) ? 0 : 1;
+
+        std::printf("Prism containment: %d wrong answers.\n", failures);
+        return failures;
+    }
+
+    // Bakes a blueprint written the way Unity saves one, and reads back the header and volume. Also checks that an asset of
+    // another class sharing the directory is skipped without writing anything. Returns the number of wrong answers.
+    int TestBlueprintBaker()
+    {
+        const char* const blueprintPath = "TestBlueprint.asset";
+        const char* const otherPath = "TestOther.asset";
+        const char* const meshPath = "TestBlueprint.bgmesh";
+        const char* const otherMeshPath = "TestOther.bgmesh";
+
+        // A single straight wall 4 long, which its thickness extends by half at each end.
+        std::ofstream(blueprintPath)
+            << "%YAML 1.1\n"
+            << "%TAG !u! tag:unity3d.com,2011:\n"
+            << "--- !u!114 &11400000\n"
+            << "MonoBehaviour:\n"
+            << "  m_Script: {fileID: 11500000, guid: e7b41f1f9e0f9e34db046eceebd9e73a, type: 3}\n"
+            << "  m_Name: TestBlueprint\n"
+            << "  _levels:\n"
+            << "  - _wallHeight: 2\n"
+            << "    _wallThickness: .5\n"
+            << "    _floorThickness: 0\n"
+            << "    _walls:\n"
+            << "    - _points:\n"
+            << "      - e0: 0\n"
+            << "        e1: 0\n"
+            << "      - e0: 4\n"
+            << "        e1: 0\n"
+            << "    _floors: []\n";
+        std::ofstream(otherPath)
+            << "%YAML 1.1\n"
+            << "%TAG !u! tag:unity3d.com,2011:\n"
+            << "--- !u!114 &11400000\n"
+            << "MonoBehaviour:\n"
+            << "  m_Script: {fileID: 11500000, guid: 0123456789abcdef0123456789abcdef, type: 3}\n"
+            << "  m_Name: TestOther\n"
+            << "  _wallHeight: 2\n";
+
+        MonotonicMemoryResource scratch(64 * 1024, GetDefaultMemoryResource());
+        std::string summary;
+
+        int failures = 0;
+        failures += (BakeBlueprint(blueprintPath, meshPath, s_SampleSpacing, 2, scratch, summary) == BlueprintBakeResult::Baked) ? 0 : 1;
+        scratch.Release();
+        failures += (BakeBlueprint(otherPath, otherMeshPath, s_SampleSpacing, 2, scratch, summary) == BlueprintBakeResult::Skipped) ? 0 : 1;
+        scratch.Release();
+        failures += std::ifstream(otherMeshPath) ? 1 : 0;
+
+        char magic[4] = {};
+        uint32_t version = 0;
+        uint32_t numLevels = 0;
+        double volume = 0.0;
+        uint32_t numLODs = 0;
+
+        std::ifstream mesh(meshPath, std::ios::binary);
+        mesh.read(magic, sizeof(magic));
+        mesh.read(reinterpret_cast<char*>(&version), sizeof(version));
+        mesh.read(reinterpret_cast<char*>(&numLevels), sizeof(numLevels));
+        mesh.read(reinterpret_cast<char*>(&volume), sizeof(volume));
+        mesh.read(reinterpret_cast<char*>(&numLODs), sizeof(numLODs));
+        failures += mesh ? 0 : 1;
+        mesh.close();
+
+        failures += (std::memcmp(magic, "BGMH", 4) == 0) ? 0 : 1;
+        failures += (version == BLUEPRINT_MESH_FILE_VERSION) ? 0 : 1;
+        failures += (numLevels == 1) ? 0 : 1;
+        failures += (std::abs(volume - 4.5 * 2.0 * 0.5) < 1e-6) ? 0 : 1;
+        failures += (numLODs == 2) ? 0 : 1;
+
+        std::remove(blueprintPath);
+        std::remove(otherPath);
+        std::remove(meshPath);
+
+        std::printf("Blueprint baking: %d wrong answers.\n", failures);
+        return failures;
+    }
+}
 
 int main(int numArgs, char* args[])
 {
-    return 0;
+    int mismatches = TestBuildingModules(Vector4(0.5, 0.25, -1.0, 1.0), Quaternion());
+
+    // Also turned about y, as modules placed along a wall would be.
+    const double halfAngle = 0.3;
+    mismatches += TestBuildingModules(Vector4(0.5, 0.25, -1.0, 1.0), Quaternion(std::cos(halfAngle), 0.0, std::sin(halfAngle), 0.0));
+
+    mismatches += TestPrismOverlaps();
+    mismatches += TestPrismContains();
+    mismatches += TestLevelSimplification();
+    mismatches += TestBlueprintBaker();
+
+    return (mismatches == 0) ? 0 : 1;
 }
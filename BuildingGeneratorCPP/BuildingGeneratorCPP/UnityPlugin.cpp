@@ -8,6 +8,74 @@
 
 #include "UnityPlugin.h"
 #include "CompositeShapeManager.h"
+#include "CompositeMesher.h"
+#include "CompositeMeshStream.h"
+#include "DebugUtils.h"
+
+#include <algorithm>
+
+// ------------------------------------------------------------------------
+
+namespace
+{
+    typedef void(__stdcall* MeshChunkHandler)(const float* vertices, const float* normals, int numVertices, const int* triangles, int numIndices);
+
+    struct MeshChunkHandlerContext
+    {
+        MeshChunkHandler handler;
+    };
+
+    void ForwardMeshChunk(const MeshChunk& chunk, void* userData)
+    {
+        const MeshChunkHandlerContext& context = *static_cast<const MeshChunkHandlerContext*>(userData);
+        context.handler(chunk.GetVertices(), chunk.GetNormals(), static_cast<int>(chunk.NumVertices()), chunk.GetTriangles(), static_cast<int>(chunk.NumIndices()));
+    }
+
+    // Unity can pass anything, so every ID and count is checked before it reaches the manager.
+    bool IsValidComposite(int compositeID)
+    {
+        if (!CompositeShapeManager::s_Instance.IsValidComposite(compositeID))
+        {
+            dbLogf("There is no composite %d.", compositeID);
+            return false;
+        }
+        return true;
+    }
+
+    bool IsValidArray(const void* pArray, int count)
+    {
+        if (count < 0 || (count > 0 && pArray == nullptr))
+        {
+            dbLogf("Invalid array of %d elements.", count);
+            return false;
+        }
+        return true;
+    }
+
+    // Returns null if the settings can't describe a chain.
+    const CompositeLODChain* FindLODChain(int compositeID, double baseVoxelSize, int numLevels)
+    {
+        if (!IsValidComposite(compositeID))
+        {
+            return nullptr;
+        }
+        if (!(baseVoxelSize > 0.0) || numLevels <= 0)
+        {
+            dbLogf("Invalid LOD settings: voxel size %f, %d levels.", baseVoxelSize, numLevels);
+            return nullptr;
+        }
+        return &CompositeShapeManager::s_Instance.GetLODChain(compositeID, baseVoxelSize, static_cast<size_t>(numLevels));
+    }
+
+    void ClearMeshChunk(const float** pVertices, const float** pNormals, int* pNumVertices, const int** pTriangles, int* pNumIndices)
+    {
+        *pVertices = nullptr;
+        *pNormals = nullptr;
+        *pNumVertices = 0;
+        *pTriangles = nullptr;
+        *pNumIndices = 0;
+    }
+}
 
 // ------------------------------------------------------------------------
 
@@ -27,10 +95,303 @@ extern "C"
 
     int EXPORT_API TestContains(double x, double y, double z)
     {
-        if (CompositeShapeManager::s_Instance.CompositeContains(0, Vector4(x, y, z, 1)))
+        if (CompositeShapeManager::s_Instance.NumComposites() > 0 && CompositeShapeManager::s_Instance.CompositeContains(0, Vector4(x, y, z, 1)))
         {
             return 1;
         }
         return 0;
     }
+
+    // Composites created after this are profiled over about this many points and have their operands reordered to make queries
+    // cheaper. Pass 0 to turn it off.
+    void EXPORT_API SetCompositeProfiling(int numSamplePoints)
+    {
+        CompositeShapeManager::s_Instance.SetOperandProfiling(static_cast<size_t>(std::max(numSamplePoints, 0)));
+    }
+
+    // Builds a composite from primitives and a postorder list of ShapeOperations. Prisms take their outlines from pPoints, as x, z pairs.
+    // Returns its ID, or -1 if the description is malformed.
+    int EXPORT_API CreateComposite(const CSGPrimitiveDesc* pPrimitives, int numPrimitives, const int* pOperations, int numOperations, const double* pPoints, int numPoints)
+    {
+        if (!IsValidArray(pPrimitives, numPrimitives) || !IsValidArray(pOperations, numOperations) || !IsValidArray(pPoints, numPoints))
+        {
+            return INVALID_COMPOSITE_SHAPE_ID;
+        }
+
+        CompositeShapeDesc desc;
+        desc.primitives = pPrimitives;
+        desc.numPrimitives = static_cast<size_t>(numPrimitives);
+        desc.operations = pOperations;
+        desc.numOperations = static_cast<size_t>(numOperations);
+        desc.points = pPoints;
+        desc.numPoints = static_cast<size_t>(numPoints);
+
+        return CompositeShapeManager::s_Instance.CreateComposite(desc);
+    }
+
+    // Builds a composite from a BuildingBlueprint level. Each wall and floor's points are x, z pairs, all packed back to back.
+    // Returns its ID, or -1 if a count is negative or doesn't match its array.
+    int EXPORT_API CreateCompositeFromLevel(double wallHeight, double wallThickness, double floorThickness,
+        const int* pWallPoints, const int* pWallPointCounts, int numWalls,
+        const int* pFloorPoints, const int* pFloorPointCounts, int numFloors)
+    {
+        if (!IsValidArray(pWallPointCounts, numWalls) || !IsValidArray(pFloorPointCounts, numFloors))
+        {
+            return INVALID_COMPOSITE_SHAPE_ID;
+        }
+
+        // Summed as 64 bit so a huge count can't wrap around into a small one.
+        long long numWallPoints = 0;
+        for (int i = 0; i < numWalls; ++i)
+        {
+            if (pWallPointCounts[i] < 0)
+            {
+                dbLogf("Wall %d has %d points.", i, pWallPointCounts[i]);
+                return INVALID_COMPOSITE_SHAPE_ID;
+            }
+            numWallPoints += pWallPointCounts[i];
+        }
+        long long numFloorPoints = 0;
+        for (int i = 0; i < numFloors; ++i)
+        {
+            if (pFloorPointCounts[i] < 0)
+            {
+                dbLogf("Floor %d has %d points.", i, pFloorPointCounts[i]);
+                return INVALID_COMPOSITE_SHAPE_ID;
+            }
+            numFloorPoints += pFloorPointCounts[i];
+        }
+        if ((numWallPoints > 0 && pWallPoints == nullptr) || (numFloorPoints > 0 && pFloorPoints == nullptr))
+        {
+            dbLogf("Missing wall or floor points.");
+            return INVALID_COMPOSITE_SHAPE_ID;
+        }
+
+        BuildingLevelDesc level;
+        level.wallHeight = wallHeight;
+        level.wallThickness = wallThickness;
+        level.floorThickness = floorThickness;
+        level.wallPoints = pWallPoints;
+        level.wallPointCounts = pWallPointCounts;
+        level.numWalls = numWalls;
+        level.floorPoints = pFloorPoints;
+        level.floorPointCounts = pFloorPointCounts;
+        level.numFloors = numFloors;
+
+        return CompositeShapeManager::s_Instance.CreateComposite(level);
+    }
+
+    // Meshes the composite within the given region, passing each chunk to the handler as soon as it is full.
+    // The chunk memory is only valid for the duration of the handler call.
+    void EXPORT_API GenerateCompositeMesh(int compositeID,
+        double originX, double originY, double originZ,
+        double sizeX, double sizeY, double sizeZ,
+        double voxelSize,
+        MeshChunkHandler pHandler)
+    {
+        if (!IsValidComposite(compositeID) || pHandler == nullptr)
+        {
+            return;
+        }
+        if (!(voxelSize > 0.0))
+        {
+            dbLogf("Invalid voxel size %f", voxelSize);
+            return;
+        }
+
+        const CompositeShape& composite = CompositeShapeManager::s_Instance.GetComposite(compositeID);
+        CompositeMesher mesher(composite, Vector4(originX, originY, originZ, 1.0), Vector4(sizeX, sizeY, sizeZ, 0.0), voxelSize);
+
+        MeshChunkHandlerContext context;
+        context.handler = pHandler;
+
+        MeshChunkRing ring(1);
+        ring.SetReadyCallback(&ForwardMeshChunk, &context);
+        mesher.Run(ring);
+    }
+
+    // Starts meshing the composite on a worker thread. Poll the stream with AcquireMeshChunk and free it with EndCompositeMeshStream.
+    // Returns null if there is no such composite, the voxel size isn't positive or there isn't at least one chunk to fill.
+    CompositeMeshStream* EXPORT_API BeginCompositeMeshStream(int compositeID,
+        double originX, double originY, double originZ,
+        double sizeX, double sizeY, double sizeZ,
+        double voxelSize,
+        int numChunks)
+    {
+        if (!IsValidComposite(compositeID))
+        {
+            return nullptr;
+        }
+        if (!(voxelSize > 0.0))
+        {
+            dbLogf("Invalid voxel size %f", voxelSize);
+            return nullptr;
+        }
+        if (numChunks <= 0)
+        {
+            dbLogf("A mesh stream needs at least one chunk, not %d.", numChunks);
+            return nullptr;
+        }
+
+        const CompositeShape& composite = CompositeShapeManager::s_Instance.GetComposite(compositeID);
+        return new CompositeMeshStream(composite,
+            Vector4(originX, originY, originZ, 1.0), Vector4(sizeX, sizeY, sizeZ, 0.0),
+            voxelSize, static_cast<size_t>(numChunks));
+    }
+
+    // Returns 1 and fills in the chunk's buffers if one is ready, 0 if the next chunk is still being generated and -1 once the stream is exhausted.
+    // The buffers stay valid until ReleaseMeshChunk is called. A null stream counts as exhausted.
+    int EXPORT_API AcquireMeshChunk(CompositeMeshStream* pStream,
+        const float** pVertices, const float** pNormals, int* pNumVertices,
+        const int** pTriangles, int* pNumIndices)
+    {
+        if (pStream == nullptr)
+        {
+            return -1;
+        }
+
+        MeshChunkRing& ring = pStream->GetRing();
+
+        MeshChunk* chunk = ring.AcquireReady();
+        if (chunk == nullptr)
+        {
+            return ring.IsDrained() ? -1 : 0;
+        }
+
+        *pVertices = chunk->GetVertices();
+        *pNormals = chunk->GetNormals();
+        *pNumVertices = static_cast<int>(chunk->NumVertices());
+        *pTriangles = chunk->GetTriangles();
+        *pNumIndices = static_cast<int>(chunk->NumIndices());
+        return 1;
+    }
+
+    // Hands the oldest acquired chunk back to the mesher so it can be refilled. Returns 1, or -1 without touching the stream if
+    // it is null or has no acquired chunk left to release.
+    int EXPORT_API ReleaseMeshChunk(CompositeMeshStream* pStream)
+    {
+        if (pStream == nullptr)
+        {
+            return -1;
+        }
+
+        MeshChunkRing& ring = pStream->GetRing();
+        return ring.Release() ? 1 : -1;
+    }
+
+    void EXPORT_API EndCompositeMeshStream(CompositeMeshStream* pStream)
+    {
+        delete pStream;
+    }
+
+    // Generates the composite's levels of detail, or reuses them if the composite hasn't changed. Returns the number of levels,
+    // or -1 if there is no such composite or the settings are invalid.
+    int EXPORT_API GenerateCompositeLODs(int compositeID, double baseVoxelSize, int numLevels)
+    {
+        const CompositeLODChain* chain = FindLODChain(compositeID, baseVoxelSize, numLevels);
+        return (chain != nullptr) ? static_cast<int>(chain->NumLevels()) : -1;
+    }
+
+    // Pass the same settings as GenerateCompositeLODs, or the chain is regenerated to match. Returns -1 if the level doesn't exist.
+    int EXPORT_API GetCompositeLODNumChunks(int compositeID, double baseVoxelSize, int numLevels, int level)
+    {
+        const CompositeLODChain* chain = FindLODChain(compositeID, baseVoxelSize, numLevels);
+        if (chain == nullptr || level < 0 || static_cast<size_t>(level) >= chain->NumLevels())
+        {
+            return -1;
+        }
+        return static_cast<int>(chain->GetLevel(level).chunks.size());
+    }
+
+    // The buffers stay valid until the composite changes and its LODs are regenerated. An empty chunk is returned if it doesn't exist.
+    void EXPORT_API GetCompositeLODChunk(int compositeID, double baseVoxelSize, int numLevels, int level, int chunk,
+        const float** pVertices, const float** pNormals, int* pNumVertices,
+        const int** pTriangles, int* pNumIndices)
+    {
+        ClearMeshChunk(pVertices, pNormals, pNumVertices, pTriangles, pNumIndices);
+
+        const CompositeLODChain* chain = FindLODChain(compositeID, baseVoxelSize, numLevels);
+        if (chain == nullptr || level < 0 || static_cast<size_t>(level) >= chain->NumLevels()
+            || chunk < 0 || static_cast<size_t>(chunk) >= chain->GetLevel(level).chunks.size())
+        {
+            return;
+        }
+        const CompositeLODChain::LODMeshChunk& lodChunk = chain->GetLevel(level).chunks[chunk];
+
+        *pVertices = lodChunk.vertices.data();
+        *pNormals = lodChunk.normals.data();
+        *pNumVertices = static_cast<int>(lodChunk.vertices.size() / 3);
+        *pTriangles = lodChunk.triangles.data();
+        *pNumIndices = static_cast<int>(lodChunk.triangles.size());
+    }
+
+    // Bytes held by the composite and whatever has been cached for it so far, by category. All zero if there is no such composite.
+    void EXPORT_API GetCompositeMemoryUsage(int compositeID, long long* pPrimitives, long long* pNodes, long long* pCaches, long long* pMeshes)
+    {
+        CompositeMemoryUsage usage;
+        if (IsValidComposite(compositeID))
+        {
+            CompositeShapeManager::s_Instance.GetMemoryUsage(compositeID, usage);
+        }
+
+        *pPrimitives = static_cast<long long>(usage.primitives);
+        *pNodes = static_cast<long long>(usage.nodes);
+        *pCaches = static_cast<long long>(usage.caches);
+        *pMeshes = static_cast<long long>(usage.meshes);
+    }
+
+    // Returns 1 if the composites overlap, 0 if they don't and -1 if either doesn't exist.
+    int EXPORT_API CompositesOverlap(int compositeA, int compositeB)
+    {
+        if (!IsValidComposite(compositeA) || !IsValidComposite(compositeB))
+        {
+            return -1;
+        }
+        return CompositeShapeManager::s_Instance.CompositesOverlap(compositeA, compositeB) ? 1 : 0;
+    }
+
+    // Writes up to maxPairs overlapping pairs into pPairs as consecutive ID pairs. Returns the total number of pairs, which may be more than maxPairs.
+    int EXPORT_API FindOverlappingComposites(int* pPairs, int maxPairs)
+    {
+        if (!IsValidArray(pPairs, maxPairs))
+        {
+            maxPairs = 0;
+        }
+
+        std::vector<std::pair<CompositeShapeID, CompositeShapeID>> pairs;
+        CompositeShapeManager::s_Instance.FindOverlappingComposites(pairs);
+
+        for (size_t i = 0, end = std::min(pairs.size(), static_cast<size_t>(maxPairs)); i < end; ++i)
+        {
+            pPairs[i * 2] = pairs[i].first;
+            pPairs[(i * 2) + 1] = pairs[i].second;
+        }
+        return static_cast<int>(pairs.size());
+    }
+
+    // Tests the composite as if it were moved to the position and orientation (a quaternion a, b, c, d) without creating anything.
+    // Writes up to maxIDs of the other composites it would overlap into pIDs. Returns the total number found, which may be more
+    // than maxIDs, or -1 if the composite doesn't exist.
+    int EXPORT_API FindPlacementOverlaps(int compositeID, double x, double y, double z,
+        double orientationA, double orientationB, double orientationC, double orientationD, int* pIDs, int maxIDs)
+    {
+        if (!IsValidComposite(compositeID))
+        {
+            return -1;
+        }
+        if (!IsValidArray(pIDs, maxIDs))
+        {
+            maxIDs = 0;
+        }
+
+        std::vector<CompositeShapeID> ids;
+        CompositeShapeManager::s_Instance.FindPlacementOverlaps(compositeID, Vector4(x, y, z, 1.0),
+            Quaternion(orientationA, orientationB, orientationC, orientationD), ids);
+
+        for (size_t i = 0, end = std::min(ids.size(), static_cast<size_t>(maxIDs)); i < end; ++i)
+        {
+            pIDs[i] = ids[i];
+        }
+        return static_cast<int>(ids.size());
+    }
 }
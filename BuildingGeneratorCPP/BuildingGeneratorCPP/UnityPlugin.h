@@ -5,6 +5,10 @@
 #ifndef INCLUDED_UNITYPLUGIN_H
 #define INCLUDED_UNITYPLUGIN_H
 
+#ifndef _MSC_VER
+#define __stdcall // Only 32 bit Windows has a choice of calling conventions, so elsewhere there is nothing to specify.
+#endif
+
 namespace UnityPlugin
 {
     static void(__stdcall* DebugOutput)(char* message);